@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+#include <sys/wait.h>
+#include <sys/sysstat.h>
+
+/*
+ * sysstat - system call statistics and tracing.
+ * Usage: sysstat
+ *        sysstat -r
+ *        sysstat -t program [args...]
+ *
+ * With no arguments, prints for every system call made since boot (or
+ * the last -r) the number of calls and failures, the average and worst
+ * time in the call, and the histogram of call times. -r resets the
+ * counts.
+ *
+ * -t runs PROGRAM and prints every system call it makes, with its
+ * arguments, result and time, like strace. The kernel keeps at most
+ * 512 records while the program runs; older ones are dropped and
+ * counted.
+ */
+
+static const char *const callnames[SYSSTAT_MAXCALL] = SYSSTAT_CALLNAMES;
+
+static
+const char *
+callname(int callno)
+{
+	static char buf[16];
+
+	if (callno >= 0 && callno < SYSSTAT_MAXCALL &&
+	    callnames[callno] != NULL) {
+		return callnames[callno];
+	}
+	snprintf(buf, sizeof(buf), "syscall%d", callno);
+	return buf;
+}
+
+static
+void
+showstats(void)
+{
+	static struct sysstat stats[SYSSTAT_MAXCALL];
+	struct sysstat *ss;
+	int i, b;
+
+	if (sysstat(SYSSTAT_STATS, stats, sizeof(stats)) < 0) {
+		err(1, "sysstat");
+	}
+
+	printf("CALL            CALLS  ERRORS   AVG US   MAX US\n");
+	for (i = 0; i < SYSSTAT_MAXCALL; i++) {
+		ss = &stats[i];
+		if (ss->ss_calls == 0) {
+			continue;
+		}
+		printf("%-12s %8u %7u %8u %8u\n", callname(i), ss->ss_calls,
+		       ss->ss_errors, ss->ss_usecs / ss->ss_calls,
+		       ss->ss_maxusecs);
+
+		/* Each bucket labelled with the shortest time it holds */
+		printf("   ");
+		for (b = 0; b < SYSSTAT_BUCKETS; b++) {
+			if (ss->ss_hist[b] != 0) {
+				printf(" %uus:%u", b == 0 ? 0 : 1U << b,
+				       ss->ss_hist[b]);
+			}
+		}
+		printf("\n");
+	}
+}
+
+static
+void
+showtrace(void)
+{
+	static struct systrace recs[32];
+	struct systrace *st;
+	int i, n, dropped;
+
+	while ((n = sysstat(SYSSTAT_TRACE, recs, sizeof(recs))) > 0) {
+		for (i = 0; i < n; i++) {
+			st = &recs[i];
+			printf("%5d %s(0x%x, 0x%x, 0x%x, 0x%x) = %d",
+			       st->st_pid, callname(st->st_callno),
+			       st->st_args[0], st->st_args[1], st->st_args[2],
+			       st->st_args[3], st->st_retval);
+			if (st->st_errno) {
+				printf(" %s", strerror(st->st_errno));
+			}
+			printf(" <%uus>\n", st->st_usecs);
+		}
+	}
+	if (n < 0) {
+		err(1, "sysstat");
+	}
+
+	dropped = sysstat(SYSSTAT_DROPPED, NULL, 0);
+	if (dropped > 0) {
+		printf("sysstat: %d records dropped\n", dropped);
+	}
+}
+
+static
+void
+trace(char **args)
+{
+	pid_t pid;
+	int status;
+
+	pid = fork();
+	if (pid < 0) {
+		err(1, "fork");
+	}
+	if (pid == 0) {
+		if (sysstat(SYSSTAT_SETTRACE, NULL, getpid()) < 0) {
+			err(1, "sysstat");
+		}
+		execv(args[0], args);
+		err(1, "%s", args[0]);
+	}
+
+	if (waitpid(pid, &status, 0) < 0) {
+		err(1, "waitpid");
+	}
+	showtrace();
+	sysstat(SYSSTAT_SETTRACE, NULL, -1);
+	printf("sysstat: %s exited with %d\n", args[0], status);
+}
+
+static
+void
+usage(void)
+{
+	errx(1, "Usage: sysstat [-r | -t program [args...]]");
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc == 1) {
+		showstats();
+	}
+	else if (!strcmp(argv[1], "-r") && argc == 2) {
+		if (sysstat(SYSSTAT_RESET, NULL, 0) < 0) {
+			err(1, "sysstat");
+		}
+	}
+	else if (!strcmp(argv[1], "-t") && argc > 2) {
+		trace(&argv[2]);
+	}
+	else {
+		usage();
+	}
+	return 0;
+}
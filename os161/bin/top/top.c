@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+#include <sys/resource.h>
+
+/*
+ * top - show CPU usage by process.
+ * Usage: top
+ *
+ * Prints accounting for every process from getrusage. The first screen
+ * covers each process's whole life; after that, each key press shows
+ * the interval since the previous screen. q quits.
+ *
+ * getrusage returns the next pid in use, which is how the process list
+ * is walked.
+ */
+
+#define MAXPROCS	128
+
+/* Previous screen, for the deltas */
+static struct rusage last[MAXPROCS];
+static pid_t lastpid[MAXPROCS];
+static int nlast;
+static struct rusage lastsys;
+
+/*
+ * Subtract OLD from NEW, field by field, in place. OLD is only used if
+ * it is for the same process (pids get reused).
+ */
+static
+void
+delta(struct rusage *nu, const struct rusage *old)
+{
+	if (old->ru_hz == 0 || strcmp(nu->ru_name, old->ru_name) != 0) {
+		return;
+	}
+	nu->ru_utime -= old->ru_utime;
+	nu->ru_stime -= old->ru_stime;
+	nu->ru_idletime -= old->ru_idletime;
+	nu->ru_waittime -= old->ru_waittime;
+	nu->ru_sleeptime -= old->ru_sleeptime;
+	nu->ru_nvcsw -= old->ru_nvcsw;
+	nu->ru_nivcsw -= old->ru_nivcsw;
+}
+
+/*
+ * Find PID's figures from the previous screen, if it was on it.
+ */
+static
+const struct rusage *
+findlast(pid_t pid)
+{
+	int i;
+
+	for (i = 0; i < nlast; i++) {
+		if (lastpid[i] == pid) {
+			return &last[i];
+		}
+	}
+	return NULL;
+}
+
+static
+unsigned
+percent(unsigned part, unsigned total)
+{
+	return total ? part * 100 / total : 0;
+}
+
+static
+void
+show(void)
+{
+	static struct rusage cur[MAXPROCS];
+	static pid_t curpid[MAXPROCS];
+	const struct rusage *old;
+	struct rusage sys, ru, now;
+	unsigned total;
+	pid_t pid, next;
+	int nprocs = 0;
+
+	next = getrusage(RUSAGE_SYSTEM, &sys);
+	if (next < 0) {
+		err(1, "getrusage");
+	}
+	now = sys;
+	delta(&sys, &lastsys);
+	lastsys = now;
+
+	total = sys.ru_utime + sys.ru_stime + sys.ru_idletime;
+	printf("\n%u ticks (%u.%02u s): %u%% user, %u%% kernel, %u%% idle, "
+	       "%u+%u switches\n", total, total / sys.ru_hz,
+	       total % sys.ru_hz * 100 / sys.ru_hz,
+	       percent(sys.ru_utime, total), percent(sys.ru_stime, total),
+	       percent(sys.ru_idletime, total), sys.ru_nvcsw, sys.ru_nivcsw);
+
+	printf("  PID NAME              %%CPU  USER   SYS  WAIT SLEEP"
+	       "  VCSW IVCSW WCHAN\n");
+	for (pid = next; pid > 0; pid = next) {
+		next = getrusage(pid, &ru);
+		if (next < 0) {
+			if (errno != ESRCH) {
+				err(1, "getrusage %d", pid);
+			}
+			/* Exited while we were looking, start again after it */
+			next = getrusage(RUSAGE_SYSTEM, &now);
+			while (next > 0 && next <= pid) {
+				next = getrusage(next, &now);
+			}
+			continue;
+		}
+		if (nprocs < MAXPROCS) {
+			cur[nprocs] = ru;
+			curpid[nprocs] = pid;
+		}
+		old = findlast(pid);
+		if (old != NULL) {
+			delta(&ru, old);
+		}
+		nprocs++;
+
+		printf("%5d %-16s %4u%% %5u %5u %5u %5u %5u %5u ", pid,
+		       ru.ru_name, percent(ru.ru_utime + ru.ru_stime, total),
+		       ru.ru_utime, ru.ru_stime, ru.ru_waittime,
+		       ru.ru_sleeptime, ru.ru_nvcsw, ru.ru_nivcsw);
+		if (ru.ru_wchan) {
+			printf("0x%x\n", ru.ru_wchan);
+		}
+		else {
+			printf("-\n");
+		}
+	}
+	printf("%d processes. Any key to refresh, q to quit.\n", nprocs);
+
+	nlast = nprocs < MAXPROCS ? nprocs : MAXPROCS;
+	memcpy(last, cur, nlast * sizeof(struct rusage));
+	memcpy(lastpid, curpid, nlast * sizeof(pid_t));
+}
+
+int
+main()
+{
+	char ch;
+
+	do {
+		show();
+		if (read(STDIN_FILENO, &ch, 1) < 0) {
+			err(1, "stdin");
+		}
+	} while (ch != 'q');
+
+	return 0;
+}
@@ -11,6 +11,42 @@
 /* Constant returned by a bunch of stdio functions on error */
 #define EOF (-1)
 
+/* Default buffer size, and the buffering modes for setvbuf */
+#define BUFSIZ  1024
+#define _IOFBF  0	/* fully buffered */
+#define _IOLBF  1	/* line buffered */
+#define _IONBF  2	/* unbuffered */
+
+/*
+ * Output stream. Only the three standard streams exist; there is no
+ * fopen. stdout is line buffered on the console and fully buffered
+ * otherwise, stderr is unbuffered. Everything is flushed by exit(),
+ * fork() and execv().
+ */
+typedef struct __file {
+	int f_fd;		/* file descriptor */
+	int f_mode;		/* _IOFBF, _IOLBF or _IONBF */
+	int f_flags;		/* internal to stdio.c */
+	int f_error;		/* set when a write fails */
+	size_t f_len;		/* bytes waiting in f_buf */
+	size_t f_size;		/* size of f_buf */
+	char *f_buf;
+} FILE;
+
+extern FILE *stdin, *stdout, *stderr;
+
+/* Write out buffered output. fflush(NULL) flushes every stream. */
+int fflush(FILE *);
+
+/* Change the buffering mode. BUF may be NULL to keep the current buffer. */
+int setvbuf(FILE *, char *buf, int mode, size_t size);
+
+/* Buffered output */
+size_t fwrite(const void *, size_t size, size_t nitems, FILE *);
+int fputc(int, FILE *);
+int putc(int, FILE *);
+int fputs(const char *, FILE *);
+
 /*
  * The actual guts of printf
  * (for libc internal use only)
@@ -23,6 +59,8 @@ int __vprintf(void (*sendfunc)(void *clientdata, const char *, size_t len),
 /* Printf calls for user programs */
 int printf(const char *fmt, ...);
 int vprintf(const char *fmt, __va_list ap);
+int fprintf(FILE *f, const char *fmt, ...);
+int vfprintf(FILE *f, const char *fmt, __va_list ap);
 int snprintf(char *buf, size_t len, const char *fmt, ...);
 int vsnprintf(char *buf, size_t len, const char *fmt, __va_list ap);
 
@@ -0,0 +1,17 @@
+#ifndef _SYS_RESOURCE_H_
+#define _SYS_RESOURCE_H_
+
+/*
+ * Get struct rusage and all the #defines from the kernel
+ */
+#include <kern/resource.h>
+
+/*
+ * WHO is RUSAGE_SELF, RUSAGE_SYSTEM, or the pid of any process. Unlike
+ * Unix getrusage, any process can be looked at, and the return value is
+ * the next pid above WHO in use (0 if none), so tools like top can walk
+ * the process list. Fails with ESRCH if there is no such process.
+ */
+int getrusage(int who, struct rusage *usage);
+
+#endif /* _SYS_RESOURCE_H_ */
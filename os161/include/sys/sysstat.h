@@ -0,0 +1,21 @@
+#ifndef _SYS_SYSSTAT_H_
+#define _SYS_SYSSTAT_H_
+
+#include <sys/types.h>
+
+/*
+ * Get struct sysstat, struct systrace and the SYSSTAT_* operations
+ * from the kernel
+ */
+#include <kern/sysstat.h>
+
+/*
+ * System call statistics and tracing. OP is one of the SYSSTAT_*
+ * operations; BUF and LEN are the buffer and its size in bytes for
+ * SYSSTAT_STATS and SYSSTAT_TRACE, and LEN is the pid for
+ * SYSSTAT_SETTRACE. Returns the number of entries copied out, the
+ * dropped count for SYSSTAT_DROPPED, or 0.
+ */
+int sysstat(int op, void *buf, int len);
+
+#endif /* _SYS_SYSSTAT_H_ */
@@ -0,0 +1,17 @@
+#ifndef _SYS_UIO_H_
+#define _SYS_UIO_H_
+
+/*
+ * Get struct iovec from the kernel
+ */
+#include <sys/types.h>
+#include <kern/iovec.h>
+
+/*
+ * Like read and write, but with IOVCNT buffers (at most IOV_MAX)
+ * described by IOV, filled or drained in order.
+ */
+int readv(int filehandle, const struct iovec *iov, int iovcnt);
+int writev(int filehandle, const struct iovec *iov, int iovcnt);
+
+#endif /* _SYS_UIO_H_ */
@@ -10,6 +10,7 @@
  */
 #include <kern/unistd.h>
 #include <kern/ioctl.h>
+#include <kern/time.h>
 
 
 /*
@@ -33,6 +34,7 @@
  *     remove:   stdio.h
  *     rename:   stdio.h
  *     time:     time.h
+ *     nanosleep: time.h
  *
  * Also note that the prototypes for open() and mkdir() contain, for
  * compatibility with Unix, an extra argument that is not meaningful
@@ -93,6 +95,9 @@ int waitpid(pid_t pid, int *returncode, int flags);
 int open(const char *filename, int flags, ...);
 int read(int filehandle, void *buf, size_t size);
 int write(int filehandle, const void *buf, size_t size);
+/* Like read and write, but at POS; the seek position is not touched. */
+int pread(int filehandle, void *buf, size_t size, off_t pos);
+int pwrite(int filehandle, const void *buf, size_t size, off_t pos);
 int close(int filehandle);
 int reboot(int code);
 int sync(void);
@@ -119,6 +124,7 @@ int readlink(const char *path, char *buf, size_t buflen);
 int dup2(int filehandle, int newhandle);
 int pipe(int filehandles[2]);
 time_t __time(time_t *seconds, unsigned long *nanoseconds);
+int nanosleep(const struct timespec *req, struct timespec *rem);
 int __getcwd(char *buf, size_t buflen);
 /* stat - see sys/stat.h */
 /* lstat - see sys/stat.h */
@@ -33,6 +33,8 @@
  * interrupt handler. (This means that the *current* thread's normal
  * context of execution is presently stopped in the middle of doing
  * something else, which makes all kinds of things unsafe to do.)
+ * interrupted_user is set on interrupt entry if that context was
+ * running in user mode.
  *
  * cpu_idle() sits around until it thinks something interesting may
  * have happened, such as an interrupt. Then it returns. It may be
@@ -49,6 +51,7 @@
 
 extern int curspl;
 extern int in_interrupt;
+extern int interrupted_user;
 
 int splhigh(void);
 int spl0(void);
@@ -34,6 +34,7 @@
  * a valid address, and will make a *huge* mess if you scribble on it.
  */
 #define PADDR_TO_KVADDR(paddr) ((paddr)+MIPS_KSEG0)
+#define KVADDR_TO_PADDR(kva) ((kva)-MIPS_KSEG0)
 
 /*
  * The top of user space. (Actually, the address immediately above the
@@ -75,7 +76,14 @@ void ram_returnmem(vaddr_t addr);
 
 // User Borrows and returns
 paddr_t ram_borrowmemuser(unsigned long npages, int pid, vaddr_t vaddr);
-void ram_zeromem(int pid, vaddr_t addr);
+void ram_zeroframe(int frame);
+
+// Pool of free frames zeroed by the idle loop
+int ram_prezero(void);
+paddr_t ram_borrowzerouser(int pid, vaddr_t vaddr);
+unsigned ram_zeropool_size(void);
+extern unsigned ram_zeropool_hits;
+extern unsigned ram_zeropool_misses;
 
 // Both user and kernel return calls this function
 void ram_removeframe(int frame); 
@@ -88,8 +96,6 @@ void ram_incrementframe(int frame);
 
 void ram_getsize(paddr_t *lo, paddr_t *hi);
 
-extern struct semaphore* memfullsemaphore;
-
 /*
  * The ELF executable type for this platform.
  */
@@ -7,6 +7,9 @@
 /* Global that signals if we're presently in an interrupt handler. */
 int in_interrupt;
 
+/* Set by mips_trap if the interrupt came in while in user mode. */
+int interrupted_user;
+
 /* 
  * General interrupt handler for mips.
  * "cause" is the contents of the c0_cause register.
@@ -76,6 +76,18 @@ ram_stealmem(unsigned long npages) {
     return paddr;
 }
 
+// Every frame below this one is in use, so the scan can start here
+static unsigned lowestfree = 0;
+
+// Free frames zeroed ahead of time by the idle loop. Entries go stale when
+// somebody else allocates the frame, which clears CM_ZEROED.
+#define ZEROPOOL_SIZE 32
+static unsigned zeropool[ZEROPOOL_SIZE];
+static unsigned zeropool_count = 0;
+static unsigned zeropool_hint = 0;
+unsigned ram_zeropool_hits = 0;
+unsigned ram_zeropool_misses = 0;
+
 // Borrow some memory as kernel
 paddr_t
 ram_borrowmem(unsigned long npages) {
@@ -83,9 +95,10 @@ ram_borrowmem(unsigned long npages) {
         return ram_stealmem(npages);
     
     
-    unsigned count = 0, i, startframe = -1;
-    for(i = 0; i < cm_totalframes; ++i) {
+    unsigned count = 0, i, startframe = -1, firstseen = -1;
+    for(i = lowestfree; i < cm_totalframes; ++i) {
         if(coremap[i].usedby == CM_FREE) {
+            if(firstseen == (unsigned) -1) firstseen = i;
             count++;
             if(count == npages) {
                 startframe = i - npages + 1;
@@ -97,36 +110,39 @@ ram_borrowmem(unsigned long npages) {
         }
     }
     
-    if(startframe == -1) {
+    if(startframe == (unsigned) -1) {
 //        kprintf("Out of memory (Swap bitch)\n");
+        if(firstseen == (unsigned) -1) lowestfree = cm_totalframes;
         return 0;
     }
+    cm_freeframes -= npages;
     for (i = startframe; i < startframe + npages; ++i) {
         coremap[i].usedby = CM_KTEMP;
+        coremap[i].cont = 1;
+        coremap[i].flags = 0;
     }
     
-    // Set the length of the mapped memory (so it can be deleted)
-    coremap[startframe].length = npages;
+    // The first frame marks the start of the run (so it can be deleted)
+    coremap[startframe].cont = 0;
     
-    return coremap[startframe].addr;
+    if(firstseen == startframe)
+        lowestfree = startframe + npages;
+    else
+        lowestfree = firstseen;
+    
+    return cm_getaddressfromframe(startframe);
 }
 
 // Kernel returns memory
 void
 ram_returnmem(vaddr_t addr) {
-    int i, startframe = -1;
-    
-    for(i = 0; i < cm_totalframes; ++i) {
-        if(PADDR_TO_KVADDR(coremap[i].addr) == addr) {
-            startframe = i;
-            break;
-        }
-    }
+    unsigned startframe = cm_getframefromaddress(addr - MIPS_KSEG0);
     
-    if (startframe == -1) {
+    if (coremap[startframe].usedby == CM_FREE || coremap[startframe].cont) {
         kprintf("ERROR 0x%x is not allocated\n", addr);
     }
-    assert(startframe != -1);
+    assert(coremap[startframe].usedby != CM_FREE);
+    assert(coremap[startframe].cont == 0);
     
     ram_removeframe(startframe);
 }
@@ -136,58 +152,27 @@ paddr_t
 ram_borrowmemuser(unsigned long npages, int pid, vaddr_t vaddr) {
     paddr_t paddr = ram_borrowmem(npages);
     if(paddr == 0) return 0;
-    struct coremap_entry* cmentry = cm_getcmentryfromaddress(paddr);
-    
-    assert(cmentry != NULL);
+    unsigned frame = cm_getframefromaddress(paddr);
 
-    cmentry->usedby = CM_USED;
-    cmentry->pid = pid;
-    cmentry->vaddr = vaddr;
-    cmentry->usecount = 1;
+    coremap[frame].usedby = CM_USED;
+    coremap[frame].usecount = 1;
+    cm_rmap[frame].vpn = vaddr >> 12;
+    cm_rmap[frame].pid = pid & CM_PIDMASK;
     
     return paddr;
 }
 
-// Zeros out a memory at a segment
-void
-ram_zeromem(int pid, vaddr_t addr) {
-    int i, startframe = -1, npages = -1;
-    
-    for(i = 0; i < cm_totalframes; ++i) {
-        if(coremap[i].vaddr == addr) {
-            startframe = i;
-            npages = coremap[i].length;
-            break;
-        }
-    }
-    
-    if (startframe == -1) {
-        kprintf("ERROR 0x%x is not allocated\n", addr);
-    }
-    assert(startframe != -1);
-    
-    ram_zeroframe(startframe);
-}
-
 // Zeros out a memory at a segment
 void
 ram_copymem(paddr_t to, paddr_t from) {
-    assert(to > firstpaddr);
-    assert(to < lastpaddr);
-    assert(from > firstpaddr);
-    assert(from < lastpaddr);
-    
-    unsigned frameto = ((to - firstpaddr) >> 12) + 1;
-    unsigned framefrom = ((from - firstpaddr) >> 12) + 1;
+    unsigned frameto = cm_getframefromaddress(to);
+    unsigned framefrom = cm_getframefromaddress(from);
     
     assert(coremap[framefrom].usedby == CM_USED);
     assert(coremap[frameto].usedby == CM_USED);
     assert(coremap[framefrom].usecount > 1);
     
-    paddr_t paddrto = coremap[frameto].addr;
-    paddr_t paddrfrom = coremap[framefrom].addr;
-    
-    memcpy(PADDR_TO_KVADDR(paddrto), PADDR_TO_KVADDR(paddrfrom), PAGE_SIZE);
+    memcpy((void *) PADDR_TO_KVADDR(to), (void *) PADDR_TO_KVADDR(from), PAGE_SIZE);
     coremap[framefrom].usecount--;
     assert(coremap[framefrom].usecount >= 1);
 }
@@ -195,9 +180,8 @@ ram_copymem(paddr_t to, paddr_t from) {
 // User increment memory usecount using frame number
 void
 ram_incrementframe(int frame) {
-    // TODO some error checking
-    int i;
-    int npages = coremap[frame].length;
+    assert(coremap[frame].usedby != CM_FREE);
+    assert(coremap[frame].usecount < CM_MAXCOUNT);
     coremap[frame].usecount++;
 }
 
@@ -209,30 +193,110 @@ ram_removeframe(int frame) {
         coremap[frame].usecount--;
         return;
     }
-    // TODO some error checking
-    int i;
-    int npages = coremap[frame].length;
-    for (i = frame; i < frame + npages; ++i) {
+    assert(coremap[frame].cont == 0);
+    
+    unsigned i = frame;
+    do {
         coremap[i].usedby = CM_FREE;
+        coremap[i].cont = 0;
+        coremap[i].flags = 0;
         coremap[i].usecount = 0;
-        coremap[i].length = 0;
-        coremap[i].vaddr = 0;
-        coremap[i].pid = 0;
-    }
+        cm_rmap[i].vpn = 0;
+        cm_rmap[i].pid = 0;
+        cm_freeframes++;
+        i++;
+    } while (i < cm_totalframes && coremap[i].cont);
+    
+    if ((unsigned) frame < lowestfree)
+        lowestfree = frame;
 }
 
 // User zeros frame
 void
 ram_zeroframe(int frame) {
-    // TODO some error checking
-    int i;
-    int npages = coremap[frame].length;
+    unsigned i;
+    unsigned npages = cm_runlength(frame);
     
     for (i = frame; i < frame + npages; ++i) {
-        bzero(PADDR_TO_KVADDR(coremap[i].addr), PAGE_SIZE);
+        bzero((void *) PADDR_TO_KVADDR(cm_getaddressfromframe(i)), PAGE_SIZE);
     }
 }
 
+// Drops pool entries whose frames were allocated behind our back
+static
+void
+zeropool_prune(void) {
+    unsigned i, n = 0;
+    for (i = 0; i < zeropool_count; ++i) {
+        unsigned frame = zeropool[i];
+        if (coremap[frame].usedby == CM_FREE && (coremap[frame].flags & CM_ZEROED))
+            zeropool[n++] = frame;
+    }
+    zeropool_count = n;
+}
+
+// Zeros one free frame for the pool. Returns 0 if there was nothing to do.
+int
+ram_prezero(void) {
+    unsigned i, frame;
+    
+    if (coremap == NULL)
+        return 0;
+    
+    zeropool_prune();
+    if (zeropool_count == ZEROPOOL_SIZE)
+        return 0;
+    
+    for (i = 0; i < cm_totalframes; ++i) {
+        frame = (zeropool_hint + i) % cm_totalframes;
+        if (coremap[frame].usedby == CM_FREE && !(coremap[frame].flags & CM_ZEROED))
+            break;
+    }
+    if (i == cm_totalframes)
+        return 0;
+    
+    bzero((void *) PADDR_TO_KVADDR(cm_getaddressfromframe(frame)), PAGE_SIZE);
+    coremap[frame].flags |= CM_ZEROED;
+    zeropool[zeropool_count++] = frame;
+    zeropool_hint = frame + 1;
+    return 1;
+}
+
+// Borrow a zeroed frame as user. Falls back to zeroing one now.
+paddr_t
+ram_borrowzerouser(int pid, vaddr_t vaddr) {
+    unsigned frame;
+    
+    zeropool_prune();
+    if (zeropool_count == 0) {
+        ram_zeropool_misses++;
+        paddr_t paddr = ram_borrowmemuser(1, pid, vaddr);
+        if (paddr != 0)
+            bzero((void *) PADDR_TO_KVADDR(paddr), PAGE_SIZE);
+        return paddr;
+    }
+    
+    ram_zeropool_hits++;
+    frame = zeropool[--zeropool_count];
+    
+    cm_freeframes--;
+    coremap[frame].usedby = CM_USED;
+    coremap[frame].cont = 0;
+    coremap[frame].flags = 0;
+    coremap[frame].usecount = 1;
+    cm_rmap[frame].vpn = vaddr >> 12;
+    cm_rmap[frame].pid = pid & CM_PIDMASK;
+    
+    return cm_getaddressfromframe(frame);
+}
+
+// Number of frames sitting zeroed in the pool
+unsigned
+ram_zeropool_size(void) {
+    zeropool_prune();
+    return zeropool_count;
+}
+
 /*
  * This function is intended to be called by the VM system when it
  * initializes in order to find out what memory it has available to
@@ -6,6 +6,7 @@
 #include <machine/trapframe.h>
 #include <kern/callno.h>
 #include <kern/unistd.h>
+#include <kern/resource.h>
 #include <syscall.h>
 #include <thread.h>
 #include <curthread.h>
@@ -13,11 +14,19 @@
 #include <kern/limits.h>
 #include <kern/../types.h>
 #include <vfs.h>
+#include <vnode.h>
+#include <uio.h>
+#include <file.h>
+#include <argbuf.h>
+#include <kern/stat.h>
 #include "addrspace.h"
 #include "coremap.h"
 #include <synch.h>
-#include <hashtable.h>
+#include <pid.h>
 #include <clock.h>
+#include <sysstat.h>
+#include <timer.h>
+#include <kern/time.h>
 
 #define DEBUG_THREADS 0
 #define DEBUG_EXEC 0
@@ -64,11 +73,21 @@ mips_syscall(struct trapframe *tf) {
     int callno;
     int32_t retval;
     int err;
+    time_t secs;
+    u_int32_t nsecs;
+    u_int32_t args[4];
 
     assert(curspl == 0);
 
     callno = tf->tf_v0;
 
+    // fork and waitpid return through a0, keep the arguments for sysstat
+    args[0] = tf->tf_a0;
+    args[1] = tf->tf_a1;
+    args[2] = tf->tf_a2;
+    args[3] = tf->tf_a3;
+    gettime(&secs, &nsecs);
+
     /*
      * Initialize retval to 0. Many of the system calls don't
      * really return a value, just 0 for success and -1 on
@@ -96,16 +115,30 @@ mips_syscall(struct trapframe *tf) {
             retval = tf->tf_a0;    // return pid
             break;
         case SYS_open:
+            err = sys_open((userptr_t) tf->tf_a0, tf->tf_a1, &retval);
             break;
         case SYS_read:
-            err = sys_read(tf);
-            retval = tf->tf_a2;
+            err = sys_read(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2, &retval);
             break;
         case SYS_write:
-            err = sys_write(tf);
-            retval = tf->tf_a2;
+            err = sys_write(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2, &retval);
+            break;
+        case SYS_readv:
+            err = sys_readv(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2, &retval);
+            break;
+        case SYS_writev:
+            err = sys_writev(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2, &retval);
+            break;
+        case SYS_pread:
+            err = sys_pread(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2,
+                    tf->tf_a3, &retval);
+            break;
+        case SYS_pwrite:
+            err = sys_pwrite(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2,
+                    tf->tf_a3, &retval);
             break;
         case SYS_close:
+            err = sys_close(tf->tf_a0);
             break;
         case SYS_sync:
             break;
@@ -117,14 +150,21 @@ mips_syscall(struct trapframe *tf) {
             err = 0;
             break;
         case SYS_ioctl:
+            err = sys_ioctl(tf->tf_a0, tf->tf_a1, (userptr_t) tf->tf_a2);
             break;
         case SYS_lseek:
+            err = sys_lseek(tf->tf_a0, tf->tf_a1, tf->tf_a2, &retval);
             break;
         case SYS_fsync:
+            err = sys_fsync(tf->tf_a0);
             break;
         case SYS_ftruncate:
             break;
         case SYS_fstat:
+            err = sys_fstat(tf->tf_a0, (userptr_t) tf->tf_a1);
+            break;
+        case SYS_dup2:
+            err = sys_dup2(tf->tf_a0, tf->tf_a1, &retval);
             break;
         case SYS_execv:
             err = sys_execv(tf);
@@ -132,12 +172,22 @@ mips_syscall(struct trapframe *tf) {
         case SYS___time:
             err = sys___time(tf, &retval); 
             break;
+        case SYS_getrusage:
+            err = sys_getrusage(tf->tf_a0, (userptr_t) tf->tf_a1, &retval);
+            break;
+        case SYS_sysstat:
+            err = sys_sysstat(tf->tf_a0, (userptr_t) tf->tf_a1, tf->tf_a2, &retval);
+            break;
+        case SYS_nanosleep:
+            err = sys_nanosleep((userptr_t) tf->tf_a0, (userptr_t) tf->tf_a1);
+            break;
         default:
             kprintf("Unknown syscall %d\n", callno);
             err = ENOSYS;
             break;
     }
 
+    sysstat_record(callno, args, err, retval, usecs_since(secs, nsecs));
 
     if (err) {
         /*
@@ -165,53 +215,297 @@ mips_syscall(struct trapframe *tf) {
 }
 
 struct lock* execvlock;
-struct semaphore* pidlimit;
-#define MAX_PIDS 5 // Maximum amount of PIDs permitted to run at the same time
 
 void syscall_bootstrap(void) {
     execvlock = lock_create("Execv");
-    pidlimit = sem_create("PID Limit", MAX_PIDS);
 }
 
 /*
- * write() system call.
+ * open() system call.
  *
  */
 int
-sys_write(struct trapframe *tf) {
-    int filehandle = tf->tf_a0;
-    char *buf = (char *) tf->tf_a1;
-    int size = tf->tf_a2;
-    
-    // Validate errors
-    if (filehandle != STDOUT_FILENO && filehandle != STDERR_FILENO) return EBADF;
- 
-    char buf2[size + 1];
+sys_open(userptr_t filename, int flags, int32_t *retval) {
     size_t actual;
-    int err = copyinstr((const_userptr_t) buf, buf2, size + 5, &actual);
-    if(err) return err;
-    buf2[size] = '\0';
-    kprintf("%s", buf2);
+    int fd;
+
+    // Too big for the kernel stack
+    char *path = kmalloc(PATH_MAX);
+    if (path == NULL) return ENOMEM;
+
+    int err = copyinstr(filename, path, PATH_MAX, &actual);
+    if (!err) err = file_open(curthread->t_files, path, flags, &fd);
+    kfree(path);
+    if (err) return err;
+
+    *retval = fd;
     return 0;
 }
 
+/*
+ * close() system call.
+ *
+ */
 int
-sys_read(struct trapframe *tf) {
-    int filehandle = tf->tf_a0;
-    char *buf = (char *) tf->tf_a1;
-    size_t size = (size_t) tf->tf_a2;
+sys_close(int fd) {
+    return file_close(curthread->t_files, fd);
+}
 
-    if (filehandle != STDIN_FILENO) return EBADF;
-    
-    char kbuf = getch();
-    size_t actual;
-    int err = copyoutstr( &kbuf, (userptr_t) buf, size + 1, &actual);
-    if(err) return err;
-    
-    putch(kbuf);
+/*
+ * dup2() system call.
+ *
+ */
+int
+sys_dup2(int oldfd, int newfd, int32_t *retval) {
+    int err = file_dup2(curthread->t_files, oldfd, newfd);
+    if (err) return err;
+
+    *retval = newfd;
+    return 0;
+}
+
+// Reads or writes the user buffers in IOV straight between the vnode and
+// user memory. POS is where in the file to do it, or -1 for the file's
+// own offset, which is then advanced.
+static
+int
+file_rw(struct openfile *of, struct iovec *iov, unsigned iovcnt, off_t pos,
+        enum uio_rw rw, int32_t *retval) {
+    struct uio u;
+    struct stat st;
+    size_t size;
+    int err = 0;
+
+    if (pos >= 0) {
+        // Positional, the shared offset is left alone
+        mk_uuiov(&u, iov, iovcnt, pos, rw);
+        size = u.uio_resid;
+        err = rw == UIO_READ ? VOP_READ(of->of_vnode, &u) :
+                VOP_WRITE(of->of_vnode, &u);
+        if (!err) *retval = size - u.uio_resid;
+        return err;
+    }
+
+    lock_acquire(of->of_lock);
+    if (rw == UIO_WRITE && (of->of_flags & O_APPEND)) {
+        err = VOP_STAT(of->of_vnode, &st);
+        if (!err) of->of_offset = st.st_size;
+    }
+    if (!err) {
+        mk_uuiov(&u, iov, iovcnt, of->of_offset, rw);
+        size = u.uio_resid;
+        err = rw == UIO_READ ? VOP_READ(of->of_vnode, &u) :
+                VOP_WRITE(of->of_vnode, &u);
+    }
+    if (!err) {
+        of->of_offset = u.uio_offset;
+        *retval = size - u.uio_resid;
+    }
+    lock_release(of->of_lock);
+    return err;
+}
+
+// Looks up FD for reading or writing
+static
+int
+file_getrw(int fd, enum uio_rw rw, struct openfile **ret) {
+    struct openfile *of;
+    int err = file_get(curthread->t_files, fd, &of);
+    if (err) return err;
+
+    if ((of->of_flags & O_ACCMODE) ==
+            (rw == UIO_READ ? O_WRONLY : O_RDONLY)) return EBADF;
+    *ret = of;
     return 0;
 }
 
+// Common part of read, write, pread and pwrite
+static
+int
+file_rw1(int fd, userptr_t buf, size_t size, off_t pos, enum uio_rw rw,
+         int32_t *retval) {
+    struct openfile *of;
+    struct iovec iov;
+
+    int err = file_getrw(fd, rw, &of);
+    if (err) return err;
+
+    if (pos >= 0) {
+        err = VOP_TRYSEEK(of->of_vnode, pos);
+        if (err) return err;
+    }
+
+    iov.iov_ubase = buf;
+    iov.iov_len = size;
+    return file_rw(of, &iov, 1, pos, rw, retval);
+}
+
+// Common part of readv and writev
+static
+int
+file_rwv(int fd, userptr_t uiov, int iovcnt, enum uio_rw rw,
+         int32_t *retval) {
+    struct openfile *of;
+    struct iovec iov[IOV_MAX];
+    size_t total = 0;
+    int i;
+
+    int err = file_getrw(fd, rw, &of);
+    if (err) return err;
+    if (iovcnt < 0 || iovcnt > IOV_MAX) return EINVAL;
+
+    err = copyin(uiov, iov, iovcnt * sizeof(struct iovec));
+    if (err) return err;
+
+    // The byte count has to fit in the return value
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len > 0x7fffffff - total) return EINVAL;
+        total += iov[i].iov_len;
+    }
+
+    return file_rw(of, iov, iovcnt, -1, rw, retval);
+}
+
+/*
+ * write() system call.
+ *
+ */
+int
+sys_write(int fd, userptr_t buf, size_t size, int32_t *retval) {
+    // The console too, con_io copies the data in a chunk at a time
+    return file_rw1(fd, buf, size, -1, UIO_WRITE, retval);
+}
+
+/*
+ * read() system call.
+ *
+ */
+int
+sys_read(int fd, userptr_t buf, size_t size, int32_t *retval) {
+    // The console line discipline decides how much one read returns
+    return file_rw1(fd, buf, size, -1, UIO_READ, retval);
+}
+
+/*
+ * pwrite() system call.
+ *
+ */
+int
+sys_pwrite(int fd, userptr_t buf, size_t size, off_t pos, int32_t *retval) {
+    if (pos < 0) return EINVAL;
+    return file_rw1(fd, buf, size, pos, UIO_WRITE, retval);
+}
+
+/*
+ * pread() system call.
+ *
+ */
+int
+sys_pread(int fd, userptr_t buf, size_t size, off_t pos, int32_t *retval) {
+    if (pos < 0) return EINVAL;
+    return file_rw1(fd, buf, size, pos, UIO_READ, retval);
+}
+
+/*
+ * writev() system call.
+ *
+ */
+int
+sys_writev(int fd, userptr_t iov, int iovcnt, int32_t *retval) {
+    return file_rwv(fd, iov, iovcnt, UIO_WRITE, retval);
+}
+
+/*
+ * readv() system call.
+ *
+ */
+int
+sys_readv(int fd, userptr_t iov, int iovcnt, int32_t *retval) {
+    return file_rwv(fd, iov, iovcnt, UIO_READ, retval);
+}
+
+/*
+ * lseek() system call.
+ *
+ */
+int
+sys_lseek(int fd, off_t pos, int whence, int32_t *retval) {
+    struct openfile *of;
+    struct stat st;
+    off_t newpos;
+
+    int err = file_get(curthread->t_files, fd, &of);
+    if (err) return err;
+
+    lock_acquire(of->of_lock);
+    switch (whence) {
+        case SEEK_SET:
+            newpos = pos;
+            break;
+        case SEEK_CUR:
+            newpos = of->of_offset + pos;
+            break;
+        case SEEK_END:
+            err = VOP_STAT(of->of_vnode, &st);
+            newpos = st.st_size + pos;
+            break;
+        default:
+            err = EINVAL;
+            break;
+    }
+    if (!err && newpos < 0) err = EINVAL;
+    if (!err) err = VOP_TRYSEEK(of->of_vnode, newpos);
+    if (!err) {
+        of->of_offset = newpos;
+        *retval = newpos;
+    }
+    lock_release(of->of_lock);
+    return err;
+}
+
+/*
+ * fstat() system call.
+ *
+ */
+int
+sys_fstat(int fd, userptr_t statbuf) {
+    struct openfile *of;
+    struct stat st;
+
+    int err = file_get(curthread->t_files, fd, &of);
+    if (err) return err;
+
+    err = VOP_STAT(of->of_vnode, &st);
+    if (err) return err;
+    return copyout(&st, statbuf, sizeof(struct stat));
+}
+
+/*
+ * ioctl() system call.
+ *
+ */
+int
+sys_ioctl(int fd, int code, userptr_t data) {
+    struct openfile *of;
+
+    int err = file_get(curthread->t_files, fd, &of);
+    if (err) return err;
+    return VOP_IOCTL(of->of_vnode, code, data);
+}
+
+/*
+ * fsync() system call.
+ *
+ */
+int
+sys_fsync(int fd) {
+    struct openfile *of;
+
+    int err = file_get(curthread->t_files, fd, &of);
+    if (err) return err;
+    return VOP_FSYNC(of->of_vnode);
+}
+
 static
 void
 child_fork(void *ptr, unsigned long nargs) {
@@ -221,6 +515,9 @@ child_fork(void *ptr, unsigned long nargs) {
     struct addrspace* addrspace2 = (struct addrspace*) argv[0];
     struct trapframe* tfchild = (struct trapframe*) argv[1];
     
+    // Descriptors shared with the parent
+    curthread->t_files = (struct filetable*) argv[2];
+    
     // Create a new address space and activate
     curthread->t_vmspace = addrspace2;
     if (curthread->t_vmspace == NULL) {
@@ -248,29 +545,59 @@ child_fork(void *ptr, unsigned long nargs) {
 
 
 int sys_fork(struct trapframe *tf) {
-    // Limit the number of forked processes
-    P(pidlimit);
+    // Refuse rather than block when over a limit or short of memory,
+    // before anything gets copied
+    int err = proc_admit(curthread->t_proc);
+    if(err) return err;
+    err = vm_forkcheck();
+    if(err) return err;
 
     // Make a copy of the address space
     struct addrspace* addrchild;
-    int err = as_copy(curthread->t_vmspace, &addrchild);
-    if(err) return ENOMEM;
+    err = as_copy(curthread->t_vmspace, &addrchild);
+    if(err) {
+        return ENOMEM;
+    }
     
     // Make a copy of the trapframe
     struct trapframe* tfchild = kmalloc(sizeof(struct trapframe));
+    if(tfchild == NULL) {
+        as_destroy(addrchild);
+        return ENOMEM;
+    }
     memcpy(tfchild, tf, sizeof(struct trapframe));
-    if(tfchild == NULL) return ENOMEM;
+    
+    // The child shares the open files
+    struct filetable* ftchild = NULL;
+    if(curthread->t_files != NULL) {
+        err = filetable_copy(curthread->t_files, &ftchild);
+        if(err) {
+            kfree(tfchild);
+            as_destroy(addrchild);
+            return err;
+        }
+    }
     
     // Pass the arguments into argv
-    unsigned *argv = kmalloc(sizeof(unsigned) * 2);
-    if(argv == NULL) return ENOMEM;
+    unsigned *argv = kmalloc(sizeof(unsigned) * 3);
+    if(argv == NULL) {
+        if(ftchild != NULL) filetable_destroy(ftchild);
+        kfree(tfchild);
+        as_destroy(addrchild);
+        return ENOMEM;
+    }
     argv[0] = (unsigned) addrchild;
     argv[1] = (unsigned) tfchild;
+    argv[2] = (unsigned) ftchild;
     
     struct thread * childthread;
-    int result = thread_fork(curthread->t_name, argv, 2, child_fork, &childthread);
+    int result = thread_fork(curthread->t_name, argv, 3, child_fork, &childthread);
     if (result) {
-        kprintf("thread_fork failed: %s\n", strerror(result));
+        // EAGAIN if another fork took the last slot since proc_admit
+        kfree(argv);
+        if(ftchild != NULL) filetable_destroy(ftchild);
+        kfree(tfchild);
+        as_destroy(addrchild);
         return result;
     }
     
@@ -298,69 +625,24 @@ int sys_waitpid(struct trapframe *tf, int call) {
     int flags = (int) tf->tf_a2;
     if(DEBUG_THREADS) kprintf("PID %d Waiting for %d\n", curthread->pid, pid);
     
-    if(pid == 0)
-        return EINVAL;
-    
-    if(pid != 1) {
-        char test[4];
-        if(copyin((const_userptr_t) returncode, &test, 1)) {
-            return EFAULT;
-        }
+    // Check the pointer first, the child is gone once we have waited
+    char test[4];
+    if(copyin((const_userptr_t) returncode, &test, 1)) {
+        return EFAULT;
     }
     
     if(flags != 0)
         return EINVAL;
     
-    // Cannot wait for current and parent PID
-    if ((unsigned)pid == curthread->pid || (unsigned)pid == curthread->parent_pid) {
-       return EINVAL;
-    }
-    
-    // Can only wait for its old child
-    if (!exists(curthread->child_pid, pid))
-        return EINVAL;
-    
-    lock_acquire(pidtablelock);
-    
-    // Check if child PID is in PID table, if not, return
-    if(!ht_get_val(&pidlist, pid)) {
-        lock_release(pidtablelock);
-        return EINVAL;
-    }
-    
-    // Check if child PID has exited
-    if(exitcodes[pid] != -1000) {
-        int childexitcode = exitcodes[pid];
-        exitcodes[pid] = -1000;
-        ht_remove(&pidlist, pid);
-        remove_val(&curthread->child_pid, pid);
-        lock_release(pidtablelock);
-        
-        copyout( &childexitcode, (userptr_t) returncode, sizeof(int));
-        return 0;
-    }
-    
-    // Create the PID CV if it doesn't exist
-    if(waitpid[pid] == NULL) {
-        waitpid[pid] = cv_create("cv");
-    }
-    
-    // While the PID is still in the PID table
-    while(exitcodes[pid] == -1000) {
-        cv_wait(waitpid[pid], pidtablelock);
-    }  
-    
-    lock_acquire(pidtablelock);
-    int childexitcode = exitcodes[pid];
-    exitcodes[pid] = -1000;
-    ht_remove(&pidlist, pid);
-    remove_val(&curthread->child_pid, pid);
-    lock_release(pidtablelock);
+    // Only children can be waited for, this sleeps until it exits
+    int childexitcode;
+    int err = proc_wait(curthread->t_proc, pid, &childexitcode);
+    if (err) return err;
     
-    copyout( &childexitcode, (userptr_t) returncode, sizeof(int));
+    err = copyout(&childexitcode, (userptr_t) returncode, sizeof(int));
     
     if(DEBUG_THREADS) kprintf("Finished waiting for PID %d\n", pid);
-    return 0;
+    return err;
 }
 
 /*
@@ -370,26 +652,16 @@ int sys_waitpid(struct trapframe *tf, int call) {
 int
 sys_exit(int exitcode) {
 //    kprintf("PID %d Exited\n", curthread->pid);
-    // Create an exit code
-    lock_acquire(pidtablelock);
-    exitcodes[curthread->pid] = exitcode;
-    
-    // Signal any sleeping threads
-    if(waitpid[curthread->pid] != NULL) {
-        lock_release(pidtablelock);
-        cv_broadcast(waitpid[curthread->pid], pidtablelock);
-    }
-    lock_release(pidtablelock);
+    // Leave the exit code for the parent and wake it if it is waiting
+    proc_exit(curthread->t_proc, exitcode, 1);
+    curthread->t_proc = NULL;
     if(DEBUG_THREADS) kprintf("PID %d Exited\n", curthread->pid);
     
-    V(pidlimit);
     thread_exit();
     
     return EINVAL;
 }
 
-#define MAX_ARG 5
-
 /*
  * sys_execv() system call.
  *
@@ -398,6 +670,8 @@ int
 sys_execv(struct trapframe *tf) {
     char *progname = (char *) tf->tf_a0;
     char **argv = (char **) tf->tf_a1;    
+    struct argbuf args;
+    userptr_t uargv;
     if(progname == NULL) return EFAULT;
     
     if(DEBUG_THREADS) kprintf("PID %d Exec\n", curthread->pid);
@@ -412,56 +686,39 @@ sys_execv(struct trapframe *tf) {
         splx(spl);
     }
     
-    // Copy to local memory
+    // Copy in the program name
     char *prognamek = kmalloc(sizeof(char) * PATH_MAX);
-    char **argvk = (char **) kmalloc(sizeof(char*) * MAX_ARG);
-    int i;
-    for (i = 0; i < MAX_ARG; ++i) {
-        argvk[i] = (char *) kmalloc(sizeof(char) * PATH_MAX);
-    }
-    
-    // Copy in the program name and arguments    
+    if (prognamek == NULL) return ENOMEM;
+
     size_t actual; 
-    if(copyinstr((const_userptr_t) progname, prognamek, PATH_MAX, &actual)) {
+    int err = copyinstr((const_userptr_t) progname, prognamek, PATH_MAX, &actual);
+    if (err) {
         kfree(prognamek);
-        for (i = 0; i < MAX_ARG; ++i) {
-            kfree(argvk[i]);
-        }
-        kfree(argvk);
-        return EFAULT; // Bad program name
+        return err; // Bad program name
     }
     
-    if(strcmp(prognamek, "") == 0)
-        return EINVAL;
-    
-    if(argv == NULL)
-        return EFAULT;
-    
-    char test[4];
-    if(copyin((const_userptr_t) argv, &test, 1)) {
-        return EFAULT;
+    if (strcmp(prognamek, "") == 0) err = EINVAL;
+    else if (argv == NULL) err = EFAULT;
+    if (err) {
+        kfree(prognamek);
+        return err;
     }
     
-    i = 0;
-    while(1) {
-        if(argv[i] == NULL) break;
-        int err = copyinstr((const_userptr_t) argv[i], argvk[i], PATH_MAX, &actual);
-        if(err == EFAULT) {
-            return EFAULT;
-        }
-        ++i;
+    // Copy in the arguments, packed into one buffer
+    argbuf_init(&args);
+    err = argbuf_copyin(&args, (const_userptr_t) argv);
+    if (err) {
+        argbuf_cleanup(&args);
+        kfree(prognamek);
+        return err;
     }
-    int argc = i;
     
     // Open the program
     struct vnode *v;
-    int err = vfs_open(prognamek, O_RDONLY, &v);
+    err = vfs_open(prognamek, O_RDONLY, &v);
     if(err) {
+        argbuf_cleanup(&args);
         kfree(prognamek);
-        for (i = 0; i < MAX_ARG; ++i) {
-            kfree(argvk[i]);
-        }
-        kfree(argvk);
         return err;
     }
     
@@ -471,59 +728,29 @@ sys_execv(struct trapframe *tf) {
     as_activate(curthread->t_vmspace);
     strcpy(curthread->t_vmspace->progname, prognamek);
     curthread->t_vmspace->progfile = v;
+    kfree(prognamek);
     
     // Load file into address space
     vaddr_t entrypoint, stackptr;
     
     err = load_elf(v, &entrypoint);
     if(err) {
-        kfree(prognamek);
-        for (i = 0; i < MAX_ARG; ++i) {
-            kfree(argvk[i]);
-        }
-        kfree(argvk);
+        argbuf_cleanup(&args);
         return err;
     }
     
     /* Define the user stack in the address space */
     err = as_define_stack(curthread->t_vmspace, &stackptr);
     if (err) {
-        kfree(prognamek);
-        for (i = 0; i < MAX_ARG; ++i) {
-            kfree(argvk[i]);
-        }
-        kfree(argvk);
+        argbuf_cleanup(&args);
         return err;
     }
     
-    // array to hold user space addresses of the args
-    char* user_space_addr[argc+1];
-
-    // copy args into user space stack
-    for (i = argc - 1; i >= 0; i--) {
-        char* s = kstrdup(argvk[i]);
-        s[strlen(s)] = '\0';
-        stackptr = stackptr - (strlen(s) + 1);
-        user_space_addr[i] = (char*) stackptr;
-        copyout(s, (userptr_t) stackptr, strlen(s) + 1);
-    }
-    
-    // set last element to NULL
-    user_space_addr[argc] = NULL;
-
-    // align stack
-    stackptr = stackptr - (stackptr % 4);
-
-    // copy array of pointers to args to the user space
-    stackptr = stackptr - ((argc+1) * sizeof (char*));
-    copyout(user_space_addr, (userptr_t) stackptr, sizeof (user_space_addr));
-    
-    // Free kernel memory
-    kfree(prognamek);
-    for (i = 0; i < MAX_ARG; ++i) {
-        kfree(argvk[i]);
-    }
-    kfree(argvk);
+    // Strings and argv go onto the user stack in one copy
+    int argc = args.ab_argc;
+    err = argbuf_copyout(&args, &stackptr, &uargv);
+    argbuf_cleanup(&args);
+    if (err) return err;
     
     if(DEBUG_EXEC){
         int spl = splhigh();
@@ -535,7 +762,7 @@ sys_execv(struct trapframe *tf) {
         splx(spl);
     }
     
-    md_usermode(argc, (userptr_t) stackptr, stackptr, entrypoint);
+    md_usermode(argc, uargv, stackptr, entrypoint);
     
     return 0;
 }
@@ -568,6 +795,38 @@ sys___time(struct trapframe *tf, int32_t* retval) {
     return 0;
 }
 
+/*
+ * sys_nanosleep() system call.
+ *
+ * Sleeps for at least the time in REQ: it is rounded up to whole clock
+ * ticks, plus one because the first tick may be only moments away.
+ * Long sleeps are taken in chunks the timer wheel can hold. Nothing
+ * cuts a sleep short here, so REM is always set to zero.
+ */
+#define NANOSLEEP_CHUNK 1000    // Seconds per timer_sleep
+
+int
+sys_nanosleep(userptr_t req, userptr_t rem) {
+    const unsigned long nsecs_per_tick = 1000000000 / HZ;
+    struct timespec ts;
+
+    int err = copyin(req, &ts, sizeof(ts));
+    if (err) return err;
+    if (ts.tv_sec < 0 || ts.tv_nsec >= 1000000000) return EINVAL;
+
+    while (ts.tv_sec > NANOSLEEP_CHUNK) {
+        timer_sleep(NANOSLEEP_CHUNK * HZ);
+        ts.tv_sec -= NANOSLEEP_CHUNK;
+    }
+    timer_sleep(ts.tv_sec * HZ +
+            (ts.tv_nsec + nsecs_per_tick - 1) / nsecs_per_tick + 1);
+
+    if (rem == NULL) return 0;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 0;
+    return copyout(&ts, rem, sizeof(ts));
+}
+
 /*
  * sys___time() system call.
  *
@@ -586,9 +845,40 @@ sys_sbrk(int increment, int32_t* retval) {
     }*/
 
     if (as->as_heap_end + increment >= as->as_heap_start) {
+        // Charge heap pages the first time the break goes past them
+        vaddr_t top = (as->as_heap_end + increment + PAGE_SIZE - 1) & PAGE_FRAME;
+        if (as->as_heap_max < as->as_heap_start) as->as_heap_max = as->as_heap_start;
+        if (top > as->as_heap_max) {
+            unsigned npages = (top - as->as_heap_max) / PAGE_SIZE;
+            if (vm_commit(npages)) return ENOMEM;
+            as->as_commit += npages;
+            as->as_heap_max = top;
+        }
         *retval = as->as_heap_end;
         as->as_heap_end += increment;        
         return 0;
     }
     return EINVAL;        
 }
+
+/*
+ * getrusage() system call.
+ *
+ */
+int
+sys_getrusage(int who, userptr_t usage, int32_t *retval) {
+    struct rusage ru;
+    pid_t next;
+
+    if (who == RUSAGE_SELF) {
+        who = curthread->pid;
+    } else if (who < RUSAGE_SYSTEM) {
+        return EINVAL;
+    }
+
+    int err = thread_getrusage(who, &ru, &next);
+    if (err) return err;
+
+    *retval = next;
+    return copyout(&ru, usage, sizeof(struct rusage));
+}
@@ -7,6 +7,8 @@
 #include <vm.h>
 #include <thread.h>
 #include <curthread.h>
+#include <addrspace.h>
+#include <kern/errno.h>
 
 #include "syscall.h"
 #include "coremap.h"
@@ -89,6 +91,7 @@ mips_trap(struct trapframe *tf) {
 
     /* Interrupt? Call the interrupt handler and return. */
     if (code == EX_IRQ) {
+        interrupted_user = !iskern;
         mips_interrupt(tf->tf_cause);
         goto done;
     }
@@ -201,6 +204,17 @@ mips_trap(struct trapframe *tf) {
     panic("I can't handle this... I think I'll just die now...\n");
 
 done:
+    /*
+     * A process picked by the OOM killer dies the next time it is on its
+     * way back to user mode.
+     */
+    if (!iskern && curthread != NULL && curthread->t_vmspace != NULL &&
+            curthread->t_vmspace->as_oomkill) {
+        splx(savespl);
+        kprintf("Out of memory: killed PID %d\n", curthread->pid);
+        sys_exit(ENOMEM);
+    }
+
     /* Make sure interrupts are off */
     splhigh();
 
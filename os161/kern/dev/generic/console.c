@@ -17,8 +17,18 @@
  * and (2) if the system crashes before we find a console, no output
  * at all may appear.
  *
- * Note that we have no input buffering; characters typed too rapidly
- * will be lost.
+ * Output is queued in a ring of CON_OBUFSIZE characters that the
+ * transmit-complete interrupt drains, so writers only wait when the
+ * ring is full. Printing with interrupts off or from an interrupt
+ * handler sends what is queued and then the new character by polling.
+ *
+ * Input is buffered in a ring of CON_IBUFSIZE characters filled at
+ * interrupt time, so typing ahead of the reader is not lost until the
+ * ring fills up. User reads go through a line discipline: in canonical
+ * mode (the default) input is echoed and edited a line at a time and a
+ * read returns at most one line; in raw mode a read returns whatever
+ * has been typed, up to the size asked for, without echo. The mode is
+ * set with the CON_IOCTL_SETMODE ioctl.
  */
 
 #include <types.h>
@@ -30,6 +40,9 @@
 #include <dev.h>
 #include <vfs.h>
 #include <uio.h>
+#include <thread.h>
+#include <kern/ioctl.h>
+#include <clock.h>
 #include "autoconf.h"
 
 /*
@@ -44,6 +57,25 @@ static struct con_softc *the_console = NULL;
 static struct lock *con_userlock_read = NULL;
 static struct lock *con_userlock_write = NULL;
 
+/*
+ * User writes are copied in a chunk at a time rather than a character
+ * at a time, through a buffer protected by con_userlock_write so it
+ * does not have to live on the kernel stack.
+ */
+#define CON_WCHUNK  128
+static char con_wbuf[CON_WCHUNK];
+
+/*
+ * Line discipline state, protected by con_userlock_read. In canonical
+ * mode con_line holds the line being read; con_linepos characters of
+ * it have been handed out so far.
+ */
+#define CON_LINEMAX 256
+static int con_mode = CON_MODE_CANON;
+static char con_line[CON_LINEMAX];
+static size_t con_linelen = 0;
+static size_t con_linepos = 0;
+
 //////////////////////////////////////////////////
 
 /*
@@ -81,64 +113,173 @@ flush_delay_buf(void)
 
 //////////////////////////////////////////////////
 
+struct con_stats con_stats;
+int con_txring = 1;
+
 /*
  * Print a character, using polling instead of interrupts to wait for
- * I/O completion.
+ * I/O completion. Anything still queued goes first so output stays in
+ * order. Called with interrupts off.
  */
 static
 void
 putch_polled(struct con_softc *cs, int ch)
 {
+	while (cs->cs_ohead != cs->cs_otail) {
+		cs->cs_sendpolled(cs->cs_devdata,
+				  cs->cs_obuf[cs->cs_ohead % CON_OBUFSIZE]);
+		cs->cs_ohead++;
+		con_stats.cs_polled++;
+	}
 	cs->cs_sendpolled(cs->cs_devdata, ch);
+	con_stats.cs_polled++;
 }
 
 //////////////////////////////////////////////////
 
 /*
  * Print a character, using interrupts to wait for I/O completion.
+ * If the device is idle the character goes straight out, otherwise it
+ * is queued for con_start. Sleeps only if the ring is full (or, with
+ * con_txring off, if anything at all is being sent).
  */
 
 static
 void
 putch_intr(struct con_softc *cs, int ch)
 {
-	P(cs->cs_wsem);
-	cs->cs_send(cs->cs_devdata, ch);
+	unsigned limit = con_txring ? CON_OBUFSIZE : 0;
+	time_t s1;
+	u_int32_t ns1;
+	int spl;
+
+	spl = splhigh();
+	if (cs->cs_obusy && cs->cs_otail - cs->cs_ohead >= limit) {
+		con_stats.cs_waits++;
+		gettime(&s1, &ns1);
+		while (cs->cs_obusy && cs->cs_otail - cs->cs_ohead >= limit) {
+			cs->cs_owaiting++;
+			thread_sleep(cs->cs_obuf);
+			cs->cs_owaiting--;
+		}
+		con_stats.cs_waitusecs += usecs_since(s1, ns1);
+	}
+
+	if (!cs->cs_obusy) {
+		cs->cs_obusy = 1;
+		cs->cs_send(cs->cs_devdata, ch);
+	}
+	else {
+		cs->cs_obuf[cs->cs_otail % CON_OBUFSIZE] = ch;
+		cs->cs_otail++;
+	}
+	splx(spl);
 }
 
 /*
- * Read a character, using interrupts to wait for I/O completion.
+ * Take a character from the input ring. If it is empty, sleep until
+ * con_input puts one there, or return -1 straight away if BLOCK is
+ * not set.
  */
 
 static
 int
-getch_intr(struct con_softc *cs)
+getch_ring(struct con_softc *cs, int block)
 {
-	P(cs->cs_rsem);
-	return cs->cs_gotchar;
+	int ch, spl;
+
+	spl = splhigh();
+	while (cs->cs_ihead == cs->cs_itail) {
+		if (!block) {
+			splx(spl);
+			return -1;
+		}
+		thread_sleep(cs);
+	}
+	ch = (unsigned char)cs->cs_ibuf[cs->cs_ihead % CON_IBUFSIZE];
+	cs->cs_ihead++;
+	splx(spl);
+
+	return ch;
 }
 
 /*
  * Called from underlying device when a read-ready interrupt occurs.
+ * Characters that arrive with the ring full are dropped.
  */
 void
 con_input(void *vcs, int ch)
 {
 	struct con_softc *cs = vcs;
 
-	cs->cs_gotchar = ch;
-	V(cs->cs_rsem);
+	if (cs->cs_itail - cs->cs_ihead < CON_IBUFSIZE) {
+		cs->cs_ibuf[cs->cs_itail % CON_IBUFSIZE] = ch;
+		cs->cs_itail++;
+		thread_wakeup(cs);
+	}
+	else {
+		con_stats.cs_overruns++;
+	}
 }
 
 /*
  * Called from underlying device when a write-done interrupt occurs.
+ * Sends the next queued character, if any.
  */
 void
 con_start(void *vcs)
 {
 	struct con_softc *cs = vcs;
 
-	V(cs->cs_wsem);
+	con_stats.cs_sent++;
+	if (cs->cs_ohead != cs->cs_otail) {
+		cs->cs_send(cs->cs_devdata,
+			    cs->cs_obuf[cs->cs_ohead % CON_OBUFSIZE]);
+		cs->cs_ohead++;
+	}
+	else {
+		cs->cs_obusy = 0;
+	}
+
+	if (cs->cs_owaiting > 0) {
+		thread_wakeup(cs->cs_obuf);
+	}
+}
+
+/*
+ * Wait until the output ring is empty and the device is idle.
+ */
+void
+con_flush(void)
+{
+	struct con_softc *cs = the_console;
+	int spl;
+
+	if (cs == NULL || in_interrupt) {
+		return;
+	}
+
+	spl = splhigh();
+	while (cs->cs_obusy) {
+		cs->cs_owaiting++;
+		thread_sleep(cs->cs_obuf);
+		cs->cs_owaiting--;
+	}
+	splx(spl);
+}
+
+void
+con_printstats(void)
+{
+	struct con_stats *s = &con_stats;
+
+	kprintf("console: output ring %s, %d bytes\n",
+		con_txring ? "on" : "off", CON_OBUFSIZE);
+	kprintf("  %u characters sent by interrupt, %u polled\n",
+		s->cs_sent, s->cs_polled);
+	kprintf("  writers waited %u times, %u us in total\n",
+		s->cs_waits, s->cs_waitusecs);
+	kprintf("  %u input characters dropped\n", s->cs_overruns);
 }
 
 //////////////////////////////////////////////////
@@ -174,7 +315,7 @@ getch(void)
 	assert(cs!=NULL);
 	assert(!in_interrupt && curspl==0);
 
-	return getch_intr(cs);
+	return getch_ring(cs, 1);
 }
 
 ////////////////////////////////////////////////////////////
@@ -200,66 +341,180 @@ con_close(struct device *dev)
 	return 0;
 }
 
+/*
+ * Echo a character typed in canonical mode.
+ */
 static
-int
-con_io(struct device *dev, struct uio *uio)
+void
+con_echo(int ch)
 {
-	int result;
-	char ch;
-	struct lock *lk;
+	if (ch=='\n') {
+		putch('\r');
+	}
+	putch(ch);
+}
 
-	(void)dev;  // unused
+/*
+ * Canonical mode: collect and echo a line, handling erase (backspace
+ * or delete), kill (^U) and end of file (^D). Returns with the line,
+ * including its newline, in con_line. A ^D at the start of a line
+ * leaves it empty, which the reader sees as end of file.
+ */
+static
+void
+con_getline(void)
+{
+	int ch;
 
-	if (uio->uio_rw==UIO_READ) {
-		lk = con_userlock_read;
-	}
-	else {
-		lk = con_userlock_write;
-	}
+	con_linelen = con_linepos = 0;
 
-	assert(lk != NULL);
-	lock_acquire(lk);
+	while (1) {
+		ch = getch();
+		if (ch=='\r') {
+			ch = '\n';
+		}
 
-	while (uio->uio_resid > 0) {
-		if (uio->uio_rw==UIO_READ) {
-			ch = getch();
-			if (ch=='\r') {
-				ch = '\n';
-			}
-			result = uiomove(&ch, 1, uio);
-			if (result) {
-				lock_release(lk);
-				return result;
+		if (ch=='\b' || ch==127) {
+			if (con_linelen > 0) {
+				con_linelen--;
+				putch('\b'); putch(' '); putch('\b');
 			}
-			if (ch=='\n') {
-				break;
+		}
+		else if (ch==21) {	/* ^U */
+			while (con_linelen > 0) {
+				con_linelen--;
+				putch('\b'); putch(' '); putch('\b');
 			}
 		}
-		else {
-			result = uiomove(&ch, 1, uio);
+		else if (ch==4) {	/* ^D */
+			return;
+		}
+		else if (ch=='\n') {
+			con_line[con_linelen++] = ch;
+			con_echo(ch);
+			return;
+		}
+		else if (con_linelen < CON_LINEMAX - 1) {
+			/* the last slot is kept for the newline */
+			con_line[con_linelen++] = ch;
+			con_echo(ch);
+		}
+	}
+}
+
+static
+int
+con_read(struct uio *uio)
+{
+	int result = 0;
+	int ch;
+	char c;
+	size_t n;
+
+	assert(con_userlock_read != NULL);
+	lock_acquire(con_userlock_read);
+
+	if (con_mode == CON_MODE_CANON) {
+		/* Hand out what is left of the last line before reading more */
+		if (con_linepos == con_linelen) {
+			con_getline();
+		}
+		n = con_linelen - con_linepos;
+		if (n > uio->uio_resid) {
+			n = uio->uio_resid;
+		}
+		result = uiomove(con_line + con_linepos, n, uio);
+		if (result == 0) {
+			con_linepos += n;
+		}
+	}
+	else {
+		/* Wait for one character, then take whatever else is there */
+		ch = getch();
+		while (ch >= 0 && uio->uio_resid > 0) {
+			c = ch;
+			result = uiomove(&c, 1, uio);
 			if (result) {
-				lock_release(lk);
-				return result;
+				break;
 			}
-			if (ch=='\n') {
+			if (uio->uio_resid > 0) {
+				ch = getch_ring(the_console, 0);
+			}
+		}
+	}
+
+	lock_release(con_userlock_read);
+	return result;
+}
+
+static
+int
+con_write(struct uio *uio)
+{
+	int result;
+	size_t i, n;
+
+	assert(con_userlock_write != NULL);
+	lock_acquire(con_userlock_write);
+
+	while (uio->uio_resid > 0) {
+		n = uio->uio_resid < CON_WCHUNK ? uio->uio_resid : CON_WCHUNK;
+		result = uiomove(con_wbuf, n, uio);
+		if (result) {
+			lock_release(con_userlock_write);
+			return result;
+		}
+		for (i=0; i<n; i++) {
+			if (con_wbuf[i]=='\n') {
 				putch('\r');
 			}
-			putch(ch);
+			putch(con_wbuf[i]);
 		}
 	}
-	lock_release(lk);
+	lock_release(con_userlock_write);
 	return 0;
 }
 
+static
+int
+con_io(struct device *dev, struct uio *uio)
+{
+	(void)dev;  // unused
+
+	if (uio->uio_rw==UIO_READ) {
+		return con_read(uio);
+	}
+	return con_write(uio);
+}
+
 static
 int
 con_ioctl(struct device *dev, int op, userptr_t data)
 {
-	/* No ioctls. */
+	int mode, result;
+
 	(void)dev;
-	(void)op;
-	(void)data;
-	return EINVAL;
+
+	switch (op) {
+	    case CON_IOCTL_GETMODE:
+		mode = con_mode;
+		return copyout(&mode, data, sizeof(int));
+	    case CON_IOCTL_SETMODE:
+		result = copyin(data, &mode, sizeof(int));
+		if (result) {
+			return result;
+		}
+		if (mode != CON_MODE_CANON && mode != CON_MODE_RAW) {
+			return EINVAL;
+		}
+		/* Switching modes throws away a partly read line */
+		lock_acquire(con_userlock_read);
+		con_mode = mode;
+		con_linelen = con_linepos = 0;
+		lock_release(con_userlock_read);
+		return 0;
+	}
+	return EIOCTL;
 }
 
 static
@@ -300,7 +555,6 @@ attach_console_to_vfs(struct con_softc *cs)
 int
 config_con(struct con_softc *cs, int unit)
 {
-	struct semaphore *rsem, *wsem;
 	struct lock *rlk, *wlk;
 
 	/*
@@ -316,32 +570,20 @@ config_con(struct con_softc *cs, int unit)
 	}
 	assert(the_console==NULL);
 
-	rsem = sem_create("console read", 0);
-	if (rsem == NULL) {
-		return ENOMEM;
-	}
-	wsem = sem_create("console write", 1);
-	if (wsem == NULL) {
-		sem_destroy(rsem);
-		return ENOMEM;
-	}
 	rlk = lock_create("console-lock-read");
 	if (rlk == NULL) {
-		sem_destroy(rsem);
-		sem_destroy(wsem);
 		return ENOMEM;
 	}
 	wlk = lock_create("console-lock-write");
 	if (wlk == NULL) {
 		lock_destroy(rlk);
-		sem_destroy(rsem);
-		sem_destroy(wsem);
 		return ENOMEM;
 	}
 
-	cs->cs_rsem = rsem; 
-	cs->cs_wsem = wsem; 
-	cs->cs_gotchar = 0;
+	cs->cs_ihead = cs->cs_itail = 0;
+	cs->cs_ohead = cs->cs_otail = 0;
+	cs->cs_obusy = 0;
+	cs->cs_owaiting = 0;
 
 	the_console = cs;
 	con_userlock_read = rlk;
@@ -8,16 +8,38 @@
  * device, and are to be initialized by the attach routine.
  */
 
+/* Characters that can be typed ahead of the reader */
+#define CON_IBUFSIZE	256
+
+/* Characters that can be queued for the device to send */
+#define CON_OBUFSIZE	1024
+
 struct con_softc {
 	/* initialized by attach routine */
 	void *cs_devdata;
 	void (*cs_send)(void *devdata, int ch);
 	void (*cs_sendpolled)(void *devdata, int ch);
 
-	/* initialized by config routine */
-	struct semaphore *cs_rsem;
-	struct semaphore *cs_wsem;
-	int cs_gotchar;
+	/*
+	 * Output ring, drained by con_start as each character finishes
+	 * sending. cs_obusy is set while the device has a character in
+	 * flight; the ring is only non-empty while it is. Writers that
+	 * find the ring full sleep on cs_obuf. Protected by splhigh.
+	 */
+	char cs_obuf[CON_OBUFSIZE];
+	unsigned cs_ohead;		/* next character to send */
+	unsigned cs_otail;		/* next free slot */
+	int cs_obusy;			/* device is sending */
+	int cs_owaiting;		/* threads sleeping on cs_obuf */
+
+	/*
+	 * Input ring, filled by con_input at interrupt time. The
+	 * counters only ever go up; cs_itail - cs_ihead characters are
+	 * waiting. Protected by splhigh.
+	 */
+	char cs_ibuf[CON_IBUFSIZE];
+	unsigned cs_ihead;		/* next character to take */
+	unsigned cs_itail;		/* next free slot */
 };
 
 /*
@@ -30,6 +52,25 @@ void con_start(/*struct con_softc*/ void *cs);
  * Functions called by higher-level code
  *
  * putch/getch - see <lib.h>
+ *
+ * con_flush      - wait until all queued output has been sent.
+ * con_printstats - print con_stats.
+ *
+ * With con_txring clear, putch waits for each character to be sent
+ * before queueing the next, as it did before the output ring.
  */
+struct con_stats {
+	unsigned cs_sent;		/* characters sent by interrupt */
+	unsigned cs_polled;		/* characters sent by polling */
+	unsigned cs_waits;		/* times a writer had to sleep */
+	unsigned cs_waitusecs;		/* time writers spent asleep */
+	unsigned cs_overruns;		/* input characters dropped */
+};
+
+extern struct con_stats con_stats;
+extern int con_txring;
+
+void con_flush(void);
+void con_printstats(void);
 
 #endif /* _GENERIC_CONSOLE_H_ */
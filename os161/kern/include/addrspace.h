@@ -35,6 +35,12 @@ struct addrspace {
     struct node* lruhandle;
     
     unsigned stackcount;
+    
+    unsigned as_commit;     // Pages charged against the commit limit
+    vaddr_t as_heap_max;    // Highest heap end charged so far
+    int as_oomkill;         // Picked by the OOM killer, exits on its next trap
+    unsigned as_oomwaits;   // Seconds spent waiting for the OOM victim
+    struct addrspace *as_next; // All address spaces, for the OOM killer
 };
 
 /*
@@ -60,6 +66,9 @@ struct addrspace {
  *    as_define_region - set up a region of memory within the address
  *                space.
  *
+ *    as_define_bss - turn the pages of a region that hold no file data
+ *                into anonymous zero-fill pages.
+ *
  *    as_prepare_load - this is called before actually loading from an
  *                executable into the address space.
  *
@@ -73,7 +82,7 @@ struct addrspace {
 
 // Page Allocation and freeing for user and 
 paddr_t alloc_upages(int npages, vaddr_t vaddr);
-void zero_upages(vaddr_t addr);
+paddr_t alloc_zeroupage(vaddr_t vaddr);
 void free_frame(int frame);
 void increment_frame(int frame);
 
@@ -92,6 +101,7 @@ int               as_define_region(struct addrspace *as,
 				   int readable, 
 				   int writeable,
 				   int executable);
+void              as_define_bss(struct addrspace *as, vaddr_t vaddr, size_t sz);
 int		  as_prepare_load(struct addrspace *as);
 int		  as_complete_load(struct addrspace *as);
 int               as_define_stack(struct addrspace *as, vaddr_t *initstackptr);
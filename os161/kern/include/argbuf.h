@@ -0,0 +1,40 @@
+#ifndef _ARGBUF_H_
+#define _ARGBUF_H_
+
+/*
+ * Program arguments on their way to a new process.
+ *
+ * execv copies the argument strings in once, packed end to end in one
+ * kernel buffer that starts small and doubles as needed, and lays them
+ * out on the new user stack with one copyout. The offset of each string
+ * is kept at the far end of the same buffer, growing down, so nothing
+ * else is allocated per argument. Strings plus the argv array are
+ * limited to ARG_MAX bytes.
+ *
+ *     argbuf_init    - set up an empty buffer.
+ *     argbuf_cleanup - free it.
+ *     argbuf_copyin  - append the strings of the NULL-terminated user
+ *                      argv array UARGV. Fails with EFAULT, or E2BIG
+ *                      if they do not fit in ARG_MAX.
+ *     argbuf_add     - append the kernel string ARG (for runprogram).
+ *     argbuf_copyout - copy the strings and the argv array onto the user
+ *                      stack below *STACKPTR, and move *STACKPTR down
+ *                      past them. Hands back the user address of argv.
+ *                      The buffer is rearranged and can only be freed
+ *                      afterwards.
+ */
+
+struct argbuf {
+    char *ab_buf;
+    size_t ab_size;             // Bytes allocated
+    size_t ab_len;              // Bytes of strings at the start
+    int ab_argc;                // Offsets at the end
+};
+
+void argbuf_init(struct argbuf *ab);
+void argbuf_cleanup(struct argbuf *ab);
+int argbuf_copyin(struct argbuf *ab, const_userptr_t uargv);
+int argbuf_add(struct argbuf *ab, const char *arg);
+int argbuf_copyout(struct argbuf *ab, vaddr_t *stackptr, userptr_t *uargv);
+
+#endif /* _ARGBUF_H_ */
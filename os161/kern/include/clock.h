@@ -7,8 +7,12 @@
  * Time-related definitions.
  *
  * hardclock() is called from the timer interrupt HZ times a second.
+ * clock_ticks counts those calls since boot, idle_ticks the ones that
+ * found no thread running.
  * gettime() may be used to fetch the current time of day.
  * getinterval() computes the time from time1 to time2.
+ * usecs_since() returns the microseconds from time1 to now; it wraps
+ * after about 71 minutes.
  */
 
 /* hardclocks per second */
@@ -22,10 +26,15 @@
 
 void hardclock(void);
 
+extern u_int32_t clock_ticks;
+extern u_int32_t idle_ticks;
+
 void gettime(time_t *seconds, u_int32_t *nanoseconds);
 
 void getinterval(time_t secs1, u_int32_t nsecs,
 		 time_t secs2, u_int32_t nsecs2,
 		 time_t *rsecs, u_int32_t *rnsecs);
 
+u_int32_t usecs_since(time_t secs, u_int32_t nsecs);
+
 #endif /* _CLOCK_H_ */
@@ -1,32 +1,54 @@
 #ifndef COREMAP_H
 #define COREMAP_H
 
+#include <types.h>
+
 #define CM_FREE     0
 #define CM_USED     1
 #define CM_KERNEL   2
 #define CM_KTEMP    3   // Temporary kernel memory for kallocs etc
 #define CM_COREMAP  4
 
+/*
+ * One word per physical frame. This is the only array scanned when looking
+ * for free memory, so it is kept as small as possible. The physical address
+ * is not stored, it is firstpaddr + index * PAGE_SIZE.
+ */
 struct coremap_entry {
-    paddr_t addr;       // Physical Address
-    unsigned usedby;    // What is the memory segment used by
-    unsigned pid;       // PID of process using this physical address
-    unsigned usecount;  // Number of processes using the entry
-    vaddr_t vaddr;      // Virtual Address
-    unsigned length;    // Length of coremap (for page allocations greater than single page)
+    u_int32_t usedby    : 3;    // What is the memory segment used by
+    u_int32_t cont      : 1;    // Frame continues the allocation of the frame before it
+    u_int32_t flags     : 12;   // Spare bits
+    u_int32_t usecount  : 16;   // Number of processes using the entry
+};
+
+/*
+ * Reverse map, only looked at when a user frame has to be traced back to
+ * its owner. The pid is only kept modulo 4096, it is for printing.
+ */
+struct coremap_rmap {
+    u_int32_t vpn       : 20;   // Virtual page number
+    u_int32_t pid       : 12;   // PID of process using this physical address
 };
 
+// Entry flags
+#define CM_ZEROED       0x001   // Free frame that has already been zeroed
+
+#define CM_MAXCOUNT     0xffff
+#define CM_PIDMASK      0xfff
+
 extern struct coremap_entry *coremap;
+extern struct coremap_rmap *cm_rmap;
 extern paddr_t firstpaddr;
 extern unsigned cm_totalframes;
 extern unsigned cm_totalkernelframes;
-
+extern unsigned cm_freeframes;      // Frames marked CM_FREE right now
 
 void coremap_bootstrap();
 void coremap_getkernelusage();
 unsigned cm_getframefromaddress(paddr_t paddr);
+paddr_t cm_getaddressfromframe(unsigned frame);
 struct coremap_entry* cm_getcmentryfromaddress(paddr_t paddr);
+unsigned cm_runlength(unsigned frame);
 void cm_print();
 
 #endif /* COREMAP_H */
-
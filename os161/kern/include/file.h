@@ -0,0 +1,59 @@
+#ifndef _FILE_H_
+#define _FILE_H_
+
+#include <kern/limits.h>
+
+/*
+ * Open files.
+ *
+ * An open file is a vnode with a seek offset and the flags it was opened
+ * with. Descriptors refer to open files, and one open file can be shared
+ * by several descriptors: the copies fork makes, and dup2 within one
+ * table. The reference count and the offset are protected by of_lock,
+ * which is held across each read or write so that processes sharing a
+ * file do not lose each other's offset updates.
+ *
+ * Every user process has a table of OPEN_MAX descriptors in t_files.
+ * runprogram creates it with the console on 0, 1 and 2, fork copies it
+ * and exit closes everything that is left.
+ *
+ *     filetable_create  - create an empty table.
+ *     filetable_stdio   - open the console on descriptors 0, 1 and 2.
+ *     filetable_copy    - copy a table for fork; the open files are
+ *                         shared, not reopened.
+ *     filetable_destroy - close every descriptor and free the table.
+ *
+ *     file_open  - vfs_open PATH with FLAGS and put it in the lowest free
+ *                  descriptor. Returns EMFILE if the table is full.
+ *     file_get   - look up descriptor FD. Returns EBADF if it is not open.
+ *     file_close - close FD, the vnode is closed with the last reference.
+ *     file_dup2  - make NEWFD refer to the same open file as OLDFD,
+ *                  closing whatever NEWFD referred to before.
+ */
+
+struct vnode;
+struct lock;
+
+struct openfile {
+    struct vnode *of_vnode;
+    off_t of_offset;
+    int of_flags;               // O_ACCMODE and O_APPEND from open
+    int of_refcount;            // Descriptors referring to this file
+    struct lock *of_lock;
+};
+
+struct filetable {
+    struct openfile *ft_files[OPEN_MAX];
+};
+
+int filetable_create(struct filetable **ret);
+int filetable_stdio(struct filetable *ft);
+int filetable_copy(struct filetable *ft, struct filetable **ret);
+void filetable_destroy(struct filetable *ft);
+
+int file_open(struct filetable *ft, char *path, int flags, int *fd);
+int file_get(struct filetable *ft, int fd, struct openfile **ret);
+int file_close(struct filetable *ft, int fd);
+int file_dup2(struct filetable *ft, int oldfd, int newfd);
+
+#endif /* _FILE_H_ */
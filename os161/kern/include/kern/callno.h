@@ -40,6 +40,13 @@
 #define SYS___getcwd     29
 #define SYS_stat         30
 #define SYS_lstat        31
+#define SYS_getrusage    32
+#define SYS_readv        33
+#define SYS_writev       34
+#define SYS_pread        35
+#define SYS_pwrite       36
+#define SYS_sysstat      37
+#define SYS_nanosleep    38
 /*CALLEND*/
 
 
@@ -37,6 +37,8 @@ const char *const sys_errlist[] = {
 	"File is not executable",     /* ENOEXEC */
 	"Argument list too long",     /* E2BIG */
 	"Bad file number",            /* EBADF */
+	"No such process",            /* ESRCH */
+	"Timed out",                  /* ETIMEDOUT */
 };
 
 /*
@@ -5,6 +5,13 @@
  * ioctl operation codes
  */
 
-/* (none yet) */
+/*
+ * Console line discipline. DATA points to an int holding the mode.
+ */
+#define CON_IOCTL_GETMODE  1
+#define CON_IOCTL_SETMODE  2
+
+#define CON_MODE_CANON     0   /* echo, line editing, one line per read */
+#define CON_MODE_RAW       1   /* no echo, whatever has been typed */
 
 #endif /* _KERN_IOCTL_H_*/
@@ -0,0 +1,28 @@
+#ifndef _KERN_IOVEC_H_
+#define _KERN_IOVEC_H_
+
+/*
+ * One buffer of a scatter/gather I/O request, as passed to readv and
+ * writev. In the kernel the address is either a kernel pointer or a
+ * user pointer, depending on the uio it belongs to (see uio.h); the
+ * layout is the same either way, so an array of them can be copied in
+ * from user space as it is.
+ */
+
+struct iovec {
+#ifdef _KERNEL
+	union {
+		void      *un_kbase;   /* kernel address (UIO_SYSSPACE) */
+		userptr_t  un_ubase;   /* user address (UIO_USER{,I}SPACE */
+	} iov_un;
+#else
+	void *iov_base;                /* user address */
+#endif
+	size_t iov_len;                /* Length of data */
+};
+#ifdef _KERNEL
+#define iov_kbase  iov_un.un_kbase
+#define iov_ubase  iov_un.un_ubase
+#endif
+
+#endif /* _KERN_IOVEC_H_ */
@@ -7,5 +7,14 @@
 /* Longest full path name */
 #define PATH_MAX   1024
 
+/* Open file descriptors per process */
+#define OPEN_MAX   32
+
+/* Bytes of argument strings and pointers passed to execv */
+#define ARG_MAX    (64 * 1024)
+
+/* Buffers in one readv or writev */
+#define IOV_MAX    16
+
 
 #endif /* _KERN_LIMITS_H_ */
@@ -0,0 +1,29 @@
+#ifndef _KERN_RESOURCE_H_
+#define _KERN_RESOURCE_H_
+
+/*
+ * Structure for getrusage (call to get CPU accounting information).
+ *
+ * Times are in clock ticks; ru_hz says how many make a second.
+ */
+
+struct rusage {
+	u_int32_t ru_utime;	/* ticks spent running in user mode */
+	u_int32_t ru_stime;	/* ticks spent running in the kernel */
+	u_int32_t ru_idletime;	/* ticks with nothing to run (system only) */
+	u_int32_t ru_waittime;	/* ticks spent runnable on the run queue */
+	u_int32_t ru_sleeptime;	/* ticks spent asleep on a wait channel */
+	u_int32_t ru_nvcsw;	/* voluntary context switches (blocked) */
+	u_int32_t ru_nivcsw;	/* involuntary context switches (preempted) */
+	u_int32_t ru_wchan;	/* wait channel slept on now, 0 if none */
+	u_int32_t ru_hz;	/* clock ticks per second */
+	char ru_name[16];	/* thread name, truncated */
+};
+
+/*
+ * Codes for getrusage. Any positive value is taken as a process id.
+ */
+#define RUSAGE_SELF	0	/* the calling process */
+#define RUSAGE_SYSTEM	(-1)	/* totals for the whole system, since boot */
+
+#endif /* _KERN_RESOURCE_H_ */
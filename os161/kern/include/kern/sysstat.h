@@ -0,0 +1,74 @@
+#ifndef _KERN_SYSSTAT_H_
+#define _KERN_SYSSTAT_H_
+
+/*
+ * System call statistics and tracing, read with the sysstat call.
+ *
+ * For each call number the kernel counts calls and failures and keeps
+ * the total and the worst time spent in the call, plus a histogram of
+ * times: bucket 0 holds calls under 2 microseconds, bucket i calls of
+ * 2^i to 2^(i+1)-1 microseconds, and the last bucket everything
+ * longer. _exit, and execv when it succeeds, never return and are not
+ * counted; fork is counted in the parent only.
+ *
+ * With tracing on, each call also leaves a record in a ring buffer;
+ * when the ring is full the oldest record is dropped.
+ */
+
+#include <kern/callno.h>
+
+#define SYSSTAT_MAXCALL   64    /* call numbers 0 .. SYSSTAT_MAXCALL-1 */
+#define SYSSTAT_BUCKETS   16    /* histogram buckets */
+
+/*
+ * Initializer for a const char *[SYSSTAT_MAXCALL] naming each call, for
+ * the kernel's report and the sysstat tool. Add new calls here.
+ */
+#define SYSSTAT_CALLNAMES {                                             \
+	[SYS__exit] = "_exit", [SYS_execv] = "execv",                   \
+	[SYS_fork] = "fork", [SYS_waitpid] = "waitpid",                 \
+	[SYS_open] = "open", [SYS_read] = "read",                       \
+	[SYS_write] = "write", [SYS_close] = "close",                   \
+	[SYS_reboot] = "reboot", [SYS_sync] = "sync",                   \
+	[SYS_sbrk] = "sbrk", [SYS_getpid] = "getpid",                   \
+	[SYS_ioctl] = "ioctl", [SYS_lseek] = "lseek",                   \
+	[SYS_fsync] = "fsync", [SYS_ftruncate] = "ftruncate",           \
+	[SYS_fstat] = "fstat", [SYS_remove] = "remove",                 \
+	[SYS_rename] = "rename", [SYS_link] = "link",                   \
+	[SYS_mkdir] = "mkdir", [SYS_rmdir] = "rmdir",                   \
+	[SYS_chdir] = "chdir", [SYS_getdirentry] = "getdirentry",       \
+	[SYS_symlink] = "symlink", [SYS_readlink] = "readlink",         \
+	[SYS_dup2] = "dup2", [SYS_pipe] = "pipe",                       \
+	[SYS___time] = "__time", [SYS___getcwd] = "__getcwd",           \
+	[SYS_stat] = "stat", [SYS_lstat] = "lstat",                     \
+	[SYS_getrusage] = "getrusage", [SYS_readv] = "readv",           \
+	[SYS_writev] = "writev", [SYS_pread] = "pread",                 \
+	[SYS_pwrite] = "pwrite", [SYS_sysstat] = "sysstat",             \
+	[SYS_nanosleep] = "nanosleep",                                  \
+}
+
+struct sysstat {
+	u_int32_t ss_calls;	/* calls made */
+	u_int32_t ss_errors;	/* calls that failed */
+	u_int32_t ss_usecs;	/* total time in the call */
+	u_int32_t ss_maxusecs;	/* longest single call */
+	u_int32_t ss_hist[SYSSTAT_BUCKETS];
+};
+
+struct systrace {
+	int32_t st_pid;		/* calling process */
+	int32_t st_callno;	/* call number */
+	u_int32_t st_args[4];	/* a0-a3 as passed */
+	int32_t st_retval;	/* return value, or -1 */
+	int32_t st_errno;	/* error code, or 0 */
+	u_int32_t st_usecs;	/* time in the call */
+};
+
+/* Operations for sysstat(op, buf, len) */
+#define SYSSTAT_STATS     0  /* copy out struct sysstat[SYSSTAT_MAXCALL] */
+#define SYSSTAT_TRACE     1  /* take up to LEN bytes of records, oldest first */
+#define SYSSTAT_RESET     2  /* zero the counts and empty the ring */
+#define SYSSTAT_SETTRACE  3  /* empty the ring, trace pid LEN; 0 all, -1 off */
+#define SYSSTAT_DROPPED   4  /* records dropped since the ring was emptied */
+
+#endif /* _KERN_SYSSTAT_H_ */
@@ -0,0 +1,13 @@
+#ifndef _KERN_TIME_H_
+#define _KERN_TIME_H_
+
+/*
+ * A length of time, for nanosleep. tv_nsec is unsigned long to match
+ * what __time fills in.
+ */
+struct timespec {
+	time_t tv_sec;			/* seconds */
+	unsigned long tv_nsec;		/* nanoseconds, below 1000000000 */
+};
+
+#endif /* _KERN_TIME_H_ */
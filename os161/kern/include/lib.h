@@ -158,7 +158,8 @@ u_int64_t ntohll(u_int64_t);
 u_int64_t htonll(u_int64_t);
 
 /*
- * copyin/copyout/copyinstr/copyoutstr are standard BSD kernel functions.
+ * copyin/copyout/copyinstr/copyoutstr/copystr are standard BSD kernel
+ * functions.
  *
  * copyin copies LEN bytes from a user-space address USERSRC to a
  * kernel-space address DEST.
@@ -176,6 +177,8 @@ u_int64_t htonll(u_int64_t);
  * returns the actual length of string found in GOT. DEST is always
  * null-terminated on success. LEN and GOT include the null terminator.
  *
+ * copystr is copyinstr for a string that is already in the kernel.
+ *
  * All of these functions return 0 on success, EFAULT if a memory
  * addressing error was encountered, or (for the string versions)
  * ENAMETOOLONG if the space available was insufficient.
@@ -191,16 +194,21 @@ int copyin(const_userptr_t usersrc, void *dest, size_t len);
 int copyout(const void *src, userptr_t userdest, size_t len);
 int copyinstr(const_userptr_t usersrc, char *dest, size_t len, size_t *got);
 int copyoutstr(const char *src, userptr_t userdest, size_t len, size_t *got);
+int copystr(const char *src, char *dest, size_t len, size_t *got);
 
 /*
  * Simple timing hooks.
  *
- * Threads sleeping on lbolt are woken up once a second.
+ * Threads sleeping on lbolt are woken up once a second. lbolt_secs and
+ * lbolt_nsecs record when that last happened.
  *
  * clocksleep() suspends execution for the requested number of seconds,
- * like userlevel sleep(3). (Don't confuse it with thread_sleep.)
+ * like userlevel sleep(3). (Don't confuse it with thread_sleep.) See
+ * timer.h for finer grained sleeps and timeouts.
  */
 extern int lbolt;
+extern time_t lbolt_secs;
+extern u_int32_t lbolt_nsecs;
 void clocksleep(int seconds);
 
 /*
@@ -13,7 +13,8 @@ struct page {
     u_int32_t PFN   : 25;       // Page Frame Number (0 - 61 (0b111101))
 };
 
-void p_allocate_page(struct page*);
+// Returns ENOMEM if there is no swap space left for the page
+int p_allocate_page(struct page*);
 
 void p_print(struct page*, int table, int page);
 
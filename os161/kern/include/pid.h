@@ -0,0 +1,79 @@
+#ifndef _PID_H_
+#define _PID_H_
+
+/*
+ * Process table.
+ *
+ * Every thread has a process record from thread_fork until its parent
+ * has collected its exit status. Pids are handed out next-fit from a
+ * bitmap, so a pid is not reused until the whole range has gone round,
+ * and records are found through a small hash on the pid. Each record
+ * holds its exit status, a CV to wait for it on, and its list of
+ * children, so memory grows with the number of live processes.
+ *
+ *     proc_bootstrap - create the table and return the record for the
+ *                      boot thread, which gets pid 0.
+ *     proc_create    - allocate a pid and a record as a child of PARENT.
+ *                      Returns EAGAIN if there are no pids left or a
+ *                      user process limit would be passed, ENOMEM if
+ *                      there is no memory.
+ *     proc_admit     - cheap check of the user process limits before a
+ *                      fork does any copying. Returns EAGAIN if creating
+ *                      a child of PARENT would fail; proc_create checks
+ *                      again under the lock.
+ *     proc_setuser   - mark P as a user process, done when it starts
+ *                      running a program. Children of user processes
+ *                      are user processes.
+ *     proc_exit      - record that P exited with EXITCODE. If KEEP is set
+ *                      the record stays until the parent waits for it;
+ *                      otherwise (kernel threads nobody waits for) it is
+ *                      freed straight away unless someone is already
+ *                      waiting. Children of P are orphaned, and the
+ *                      ones that have already exited are freed.
+ *     proc_wait      - wait for child PID of PARENT to exit, free its
+ *                      record and hand back its exit code. Returns
+ *                      EINVAL if PID is not a child of PARENT.
+ *     proc_count     - number of records in use.
+ *     proc_usercount - number of user process records in use.
+ *
+ * User processes are limited to proc_maxprocs in total, and each one to
+ * p_maxchildren children that have not been waited for. A new process
+ * gets proc_maxchildren, and keeps it for its lifetime. Kernel threads
+ * are not limited.
+ */
+
+#define PID_MIN     1
+#define PID_MAX     32767
+
+#define PROC_MAXPROCS       64  // Default for proc_maxprocs
+#define PROC_MAXCHILDREN    32  // Default for proc_maxchildren
+
+struct proc {
+    pid_t p_pid;
+    int p_exited;               // Set by proc_exit
+    int p_exitcode;
+    int p_waiting;              // Threads sleeping in proc_wait
+    struct cv *p_waitcv;        // Created by the first proc_wait
+    struct proc *p_parent;      // NULL once the parent has exited
+    struct proc *p_children;    // First child
+    struct proc *p_sibnext;     // Next and previous child of p_parent
+    struct proc *p_sibprev;
+    struct proc *p_hashnext;    // Next record in the same hash bucket
+    int p_user;                 // Set by proc_setuser or inherited
+    int p_nchildren;            // Length of p_children
+    int p_maxchildren;          // Limit on p_nchildren for user processes
+};
+
+extern int proc_maxprocs;
+extern int proc_maxchildren;
+
+struct proc *proc_bootstrap(void);
+int proc_create(struct proc *parent, struct proc **ret);
+void proc_exit(struct proc *p, int exitcode, int keep);
+int proc_wait(struct proc *parent, pid_t pid, int *exitcode);
+int proc_count(void);
+int proc_admit(struct proc *parent);
+void proc_setuser(struct proc *p);
+int proc_usercount(void);
+
+#endif /* _PID_H_ */
@@ -9,6 +9,10 @@
  *                     already on the run queue or sleeping, weird things
  *                     may happen. Returns an error code.
  *
+ *     scheduler_tick - called from hardclock on every tick. Returns nonzero
+ *                     if the current thread has used up its quantum and
+ *                     some other thread is waiting to run.
+ *
  *     print_run_queue - dump the run queue to the console for debugging.
  *
  *     scheduler_bootstrap - initialize scheduler data 
@@ -16,12 +20,24 @@
  *     scheduler_shutdown -  clean up scheduler data
  *     scheduler_preallocate - ensure space for at least NUMTHREADS threads.
  *                           Returns an error code.
+ *
+ * Two schedulers implement this interface: the round robin one in
+ * scheduler.c and, with "options mlfq", the multi-level feedback queue
+ * in mlfq.c.
+ *
+ * sched_quantum is the time slice in hardclock ticks. The mlfq scheduler
+ * uses it for its top level and doubles it for each level below.
  */
 
+#define SCHED_QUANTUM	2	/* default time slice, in ticks */
+
 struct thread;
 
+extern int sched_quantum;
+
 struct thread *scheduler(void);
 int make_runnable(struct thread *t);
+int scheduler_tick(void);
 
 void print_run_queue(void);
 
@@ -30,6 +46,4 @@ int scheduler_preallocate(int numthreads);
 void scheduler_killall(void);
 void scheduler_shutdown(void);
 
-struct queue* get_run_queue(void);
-
 #endif /* _SCHEDULER_H_ */
@@ -21,6 +21,7 @@ extern Swapmap* swapmap;
 extern struct node* swapcount; // For situations where 2 processes using the same swap area
 
 extern int sm_pagecount; // 1280 or 0x500
+extern int sm_freeslots;  // Unmarked slots in the swapmap
 
 void sm_bootstrap();
 
@@ -38,6 +39,9 @@ int sm_swapout(struct page* p, vaddr_t vaddr);
 // Finds the spot in the swap file to swap in a piece of memory
 int sm_swapin(struct page* p, vaddr_t vaddr);
 
+// Gives a never allocated page a zeroed frame, nothing is read from disk
+int sm_zerofill(struct page* p, vaddr_t vaddr);
+
 // Actually increment the swap bit. But uses the external linked list to count doubles
 int sm_swapdecrement(struct page* p);
 
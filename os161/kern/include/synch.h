@@ -11,6 +11,8 @@
  *     P (proberen): decrement count. If the count is 0, block until
  *                   the count is 1 again before decrementing.
  *     V (verhogen): increment count.
+ *     P_timeout:    like P, but give up after MSECS milliseconds.
+ *                   Returns 0, or ETIMEDOUT without decrementing.
  * 
  * Both operations are atomic.
  *
@@ -26,6 +28,7 @@ struct semaphore {
 struct semaphore *sem_create(const char *name, int initial_count);
 void              P(struct semaphore *);
 void              V(struct semaphore *);
+int               P_timeout(struct semaphore *, u_int32_t msecs);
 void              sem_destroy(struct semaphore *);
 
 
@@ -53,6 +56,7 @@ struct lock {
 	// add what you need here
 	// (don't forget to mark things volatile as needed)
         volatile int held;
+        struct thread *volatile holder;	/* owner, handed to the next waiter on release */
 };
 
 struct lock *lock_create(const char *name);
@@ -73,6 +77,9 @@ void         lock_destroy(struct lock *lock);
  *                   waking up again, re-acquire the lock.
  *    cv_signal    - Wake up one thread that's sleeping on this CV.
  *    cv_broadcast - Wake up all threads sleeping on this CV.
+ *    cv_wait_timeout - Like cv_wait, but wake up after MSECS milliseconds
+ *                   if not signalled first. Returns 0, or ETIMEDOUT;
+ *                   the lock is held again either way.
  *
  * For all three operations, the current thread must hold the lock passed 
  * in. Note that under normal circumstances the same lock should be used
@@ -95,6 +102,7 @@ struct cv {
 
 struct cv *cv_create(const char *name);
 void       cv_wait(struct cv *cv, struct lock *lock);
+int        cv_wait_timeout(struct cv *cv, struct lock *lock, u_int32_t msecs);
 void       cv_signal(struct cv *cv, struct lock *lock);
 void       cv_broadcast(struct cv *cv, struct lock *lock);
 void       cv_destroy(struct cv *);
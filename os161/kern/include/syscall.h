@@ -10,17 +10,23 @@ int sys_exit(int exitcode);
 int sys_execv(struct trapframe *tf);
 pid_t sys_fork(struct trapframe *tf);
 int sys_waitpid(struct trapframe *tf, int call);
-int sys_open(const char *filename, int flags, ...);
-int sys_read(struct trapframe *tf);
-int sys_write(struct trapframe *tf);
-int sys_close(int filehandle);
+int sys_open(userptr_t filename, int flags, int32_t *retval);
+int sys_read(int fd, userptr_t buf, size_t size, int32_t *retval);
+int sys_write(int fd, userptr_t buf, size_t size, int32_t *retval);
+int sys_readv(int fd, userptr_t iov, int iovcnt, int32_t *retval);
+int sys_writev(int fd, userptr_t iov, int iovcnt, int32_t *retval);
+int sys_pread(int fd, userptr_t buf, size_t size, off_t pos, int32_t *retval);
+int sys_pwrite(int fd, userptr_t buf, size_t size, off_t pos, int32_t *retval);
+int sys_close(int fd);
+int sys_dup2(int oldfd, int newfd, int32_t *retval);
 int sys_reboot(int code);
 int sys_sync(void);
 int sys_rmdir(const char *dirname);
 int sys_getpid(struct trapframe *tf);
-int sys_ioctl(int filehandle, int code, void *buf);
-int sys_lseek(int filehandle, off_t pos, int code);
-int sys_fsync(int filehandle);
+int sys_ioctl(int fd, int code, userptr_t data);
+int sys_lseek(int fd, off_t pos, int whence, int32_t *retval);
+int sys_fsync(int fd);
+int sys_fstat(int fd, userptr_t statbuf);
 int sys_ftruncate(int filehandle, off_t size);
 int sys_remove(const char *filename);
 int sys_rename(const char *oldfile, const char *newfile);
@@ -28,10 +34,12 @@ int sys_link(const char *oldfile, const char *newfile);
 int sys_chdir(const char *path);
 int sys___time(struct trapframe *tf, int32_t* retval);
 int sys_sbrk(int increment, int32_t* retval);
+int sys_getrusage(int who, userptr_t usage, int32_t *retval);
+int sys_sysstat(int op, userptr_t buf, int len, int32_t *retval);
+int sys_nanosleep(userptr_t req, userptr_t rem);
 
 void syscall_bootstrap(void);
 
 extern struct lock *execv_lock;
-extern struct semaphore* pidlimit;
 
 #endif /* _SYSCALL_H_ */
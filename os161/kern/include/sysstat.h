@@ -0,0 +1,26 @@
+#ifndef _SYSSTAT_H_
+#define _SYSSTAT_H_
+
+#include <kern/sysstat.h>
+
+/*
+ * System call instrumentation, see kern/sysstat.h.
+ *
+ * mips_syscall calls sysstat_record as each call returns. The counts
+ * are always kept; it costs two clock reads and a few additions per
+ * call. The trace ring only fills when tracing is turned on with
+ * SYSSTAT_SETTRACE.
+ *
+ *     sysstat_bootstrap  - allocate the trace ring.
+ *     sysstat_record     - account for one call.
+ *     sysstat_printstats - print the counts on the console.
+ */
+
+#define SYSSTAT_RINGSIZE  512   /* trace records kept */
+
+void sysstat_bootstrap(void);
+void sysstat_record(int callno, const u_int32_t *args, int err,
+                    int32_t retval, u_int32_t usecs);
+void sysstat_printstats(void);
+
+#endif /* _SYSSTAT_H_ */
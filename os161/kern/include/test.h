@@ -27,6 +27,12 @@ int threadtest3(int, char **);
 int semtest(int, char **);
 int locktest(int, char **);
 int cvtest(int, char **);
+int timeouttest(int, char **);
+int synchbench(int, char **);
+int schedbench(int, char **);
+int joinbench(int, char **);
+int consolebench(int, char **);
+int copybench(int, char **);
 
 /* filesystem tests */
 int fstest(int, char **);
@@ -40,6 +46,7 @@ int printfile(int, char **);
 int malloctest(int, char **);
 int mallocstress(int, char **);
 int nettest(int, char **);
+int coremapbench(int, char **);
 
 /* Kernel menu system */
 void menu(char *argstr);
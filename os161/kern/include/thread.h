@@ -7,11 +7,12 @@
 
 /* Get machine-dependent stuff */
 #include <machine/pcb.h>
-#include <hashtable.h>
 #include <linkedlist.h>
 #include <page.h>
+#include <kern/resource.h>
 
 struct addrspace;
+struct filetable;
 
 struct thread {
 	/**********************************************************/
@@ -21,15 +22,23 @@ struct thread {
 	struct pcb t_pcb;
 	char *t_name;
 	const void *t_sleepaddr;
+	struct thread *t_sleepnext;	/* next thread on the same wait channel */
 	char *t_stack;
+	int t_level;			/* MLFQ priority level, 0 is highest */
+	int t_ticks;			/* ticks used of the current quantum */
+	int t_timedout;			/* thread_sleep_timeout timer went off */
+	int t_woken;			/* make_runnable is for a wakeup */
+	struct rusage t_rusage;		/* CPU accounting, see getrusage */
+	u_int32_t t_stamp;		/* tick it was queued or went to sleep */
+	int t_joinable;			/* kept after exit for thread_join */
+	int t_exited;			/* set when a joinable thread exits */
 	
 	/**********************************************************/
 	/* Public thread members - can be used by other code      */
 	/**********************************************************/
 	
         unsigned pid;
-        unsigned parent_pid;
-        struct node *child_pid;
+        struct proc *t_proc;    /* process table record, see pid.h */
         unsigned exitcode;
         
 	/*
@@ -45,13 +54,12 @@ struct thread {
 	 */
 	struct vnode *t_cwd;
 
-};
+	/*
+	 * Open file descriptors of a user process, see file.h.
+	 */
+	struct filetable *t_files;
 
-/* List of PIDs*/
-struct htable pidlist;
-struct cv *waitpid[10000];
-struct lock *pidtablelock;
-int exitcodes[10000];
+};
 
 
 /* Call once during startup to allocate data structures. */
@@ -78,10 +86,22 @@ int thread_fork(const char *name,
 		void (*func)(void *, unsigned long),
 		struct thread **ret);
 
-/* Thread Join
+/*
+ * Same as thread_fork, but the new thread is joinable: when it exits
+ * it is kept around until thread_join is called on it, which must
+ * happen exactly once. RET must not be null.
  */
+int thread_fork_joinable(const char *name,
+			 void *data1, unsigned long data2,
+			 void (*func)(void *, unsigned long),
+			 struct thread **ret);
 
-void thread_join(const char *name);
+/*
+ * Wait for a joinable thread to exit and return its exit value (0 if
+ * it called thread_exit or returned, otherwise what it passed to
+ * thread_exitval). The thread structure is freed.
+ */
+int thread_join(struct thread *t);
 
 /*
  * Cause the current thread to exit.
@@ -89,6 +109,11 @@ void thread_join(const char *name);
  */
 void thread_exit(void);
 
+/*
+ * Same as thread_exit, but passes EXITVAL to thread_join.
+ */
+void thread_exitval(int exitval);
+
 /*
  * Cause the current thread to yield to the next runnable thread, but
  * itself stay runnable.
@@ -104,12 +129,47 @@ void thread_yield(void);
  */
 void thread_sleep(const void *addr);
 
+/*
+ * Like thread_sleep, but also wake up after TICKS clock ticks if
+ * nothing else has. Returns 0 if woken by thread_wakeup or
+ * thread_wakeone, or ETIMEDOUT. Interrupts must be disabled.
+ */
+int thread_sleep_timeout(const void *addr, u_int32_t ticks);
+
 /*
  * Cause all threads sleeping on the specified address to wake up.
  * Interrupts must be disabled.
  */
 void thread_wakeup(const void *addr);
 
+/*
+ * Wake up the thread that has been sleeping longest on the specified
+ * address, if any. Returns the thread woken, or NULL.
+ * Interrupts must be disabled.
+ */
+struct thread *thread_wakeone(const void *addr);
+
+/* Number of context switches since boot. */
+extern unsigned thread_switchcount;
+
+/*
+ * Fill in USAGE for the thread with process id PID, or totals for the
+ * whole system if PID is RUSAGE_SYSTEM, and set NEXTPID to the lowest
+ * pid above PID that belongs to a live thread (0 if none). Returns
+ * ESRCH if there is no such thread.
+ */
+int thread_getrusage(int pid, struct rusage *usage, pid_t *nextpid);
+
+/*
+ * Dead threads and their stacks are cached for reuse by thread_fork.
+ * Clearing thread_cache_enabled makes every fork allocate afresh.
+ */
+extern int thread_cache_enabled;
+extern unsigned thread_cache_hits, thread_cache_misses;
+
+/* Print accounting for every thread, and sleep time by wait channel. */
+void thread_printstats(void);
+
 /*
  * Return nonzero if there are any threads sleeping on the specified
  * address. Meant only for diagnostic purposes.
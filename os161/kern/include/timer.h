@@ -0,0 +1,53 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+/*
+ * Kernel timers.
+ *
+ * A timer calls a function once, a given number of clock ticks after
+ * it is started. Pending timers are kept in a hierarchical timer wheel:
+ * the first level has a slot for each of the next 256 ticks, and each
+ * of three more levels has 64 slots, each slot covering a whole turn of
+ * the level below. When the first level comes round to slot 0, the
+ * next slot of the level above is cascaded down into it. Starting and
+ * stopping a timer take constant time, and hardclock looks at a single
+ * slot per tick however many timers are pending.
+ *
+ * Timer functions are called from hardclock, in the interrupt handler,
+ * so they must not sleep. Everything here except timer_sleep must be
+ * called with interrupts off.
+ *
+ *     timer_init  - set up TM to call FUNC(DATA).
+ *     timer_start - start TM to expire on the TICKS'th clock tick from
+ *                   now (the next one if TICKS is 0), stopping it first
+ *                   if it is pending. Delays longer than TIMER_MAXTICKS
+ *                   are cut to that.
+ *     timer_stop  - stop TM. Returns nonzero if it had not gone off.
+ *     timer_tick  - run the timers that are due, called by hardclock.
+ *
+ *     timer_sleep - put the current thread to sleep for TICKS ticks.
+ *     mstoticks   - convert milliseconds to ticks, rounding up.
+ *
+ * Timed waits on wait channels, semaphores and CVs are built on this,
+ * see thread_sleep_timeout, P_timeout and cv_wait_timeout.
+ */
+
+#define TIMER_MAXTICKS  ((1 << 26) - 2)    /* what the wheel can hold */
+
+struct timer {
+	struct timer *tm_next;
+	struct timer **tm_pprev;	/* link pointing at us, NULL if stopped */
+	u_int32_t tm_expires;		/* clock_ticks value it goes off at */
+	void (*tm_func)(void *);
+	void *tm_data;
+};
+
+void timer_init(struct timer *tm, void (*func)(void *), void *data);
+void timer_start(struct timer *tm, u_int32_t ticks);
+int timer_stop(struct timer *tm);
+void timer_tick(void);
+
+void timer_sleep(u_int32_t ticks);
+u_int32_t mstoticks(u_int32_t msecs);
+
+#endif /* _TIMER_H_ */
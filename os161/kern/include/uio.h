@@ -1,9 +1,15 @@
 #ifndef _UIO_H_
 #define _UIO_H_
 
+#include <kern/iovec.h>
+
 /*
- * Like BSD uio, but simplified a bit. (In BSD, there can be more than one
- * iovec in a uio.)
+ * Like BSD uio, but simplified a bit.
+ *
+ * A uio describes an array of uio_iovcnt buffers, all in the same
+ * address space, that are filled or drained in order. Most transfers
+ * only have one buffer; mk_kuio and mk_uuio use uio_iovec inside the
+ * uio for it. (So such a uio must not be copied by assignment.)
  */
 
 enum uio_rw {
@@ -17,18 +23,10 @@ enum uio_seg {
 	UIO_USERISPACE,
 };
 
-struct iovec {
-	union {
-		void      *un_kbase;   /* kernel address (UIO_SYSSPACE) */
-		userptr_t  un_ubase;   /* user address (UIO_USER{,I}SPACE */
-	} iov_un;
-	size_t iov_len;                /* Length of data */
-};
-#define iov_kbase  iov_un.un_kbase
-#define iov_ubase  iov_un.un_ubase
-
 struct uio {
-	struct iovec      uio_iovec;       /* Data block */
+	struct iovec     *uio_iov;         /* Data blocks */
+	unsigned          uio_iovcnt;      /* Number of blocks left */
+	struct iovec      uio_iovec;       /* Data block, if only one */
 	off_t             uio_offset;      /* desired offset into object */
 	size_t            uio_resid;       /* Remaining amt of data to xfer */
 	enum uio_seg      uio_segflg;      /* what kind of pointer we have */
@@ -43,7 +41,8 @@ struct uio {
  * fields as well.
  *
  * Before calling this, you should
- *   (1) set up uio_iovec to point to the buffer you want to transfer to;
+ *   (1) set up uio_iov and uio_iovcnt to point to the buffers you want
+ *       to transfer to;
  *   (2) initialize uio_offset as desired;
  *   (3) initialize uio_resid to the total amount of data that can be 
  *       transferred through this uio;
@@ -53,8 +52,8 @@ struct uio {
  *       should be found.
  *
  * After calling, 
- *   (1) the contents of uio_iovec may be altered and should not be 
- *       interpreted;
+ *   (1) uio_iov, uio_iovcnt and the contents of the iovecs may be
+ *       altered and should not be interpreted;
  *   (2) uio_offset will have been incremented by the amount transferred;
  *   (3) uio_resid will have been decremented by the amount transferred;
  *   (4) uio_segflg, uio_rw, and uio_space will be unchanged.
@@ -83,4 +82,18 @@ int uiomovezeros(size_t len, struct uio *uio);
  */
 void mk_kuio(struct uio *, void *kbuf, size_t len, off_t pos, enum uio_rw rw);
 
+/*
+ * Initialize uio for I/O straight to or from a buffer in the current
+ * process's address space.
+ */
+void mk_uuio(struct uio *, userptr_t ubuf, size_t len, off_t pos,
+	     enum uio_rw rw);
+
+/*
+ * Same, for the IOVCNT user buffers in IOV. The iovecs are updated as
+ * the transfer proceeds, so they must stay put until it is done.
+ */
+void mk_uuiov(struct uio *, struct iovec *iov, unsigned iovcnt, off_t pos,
+	      enum uio_rw rw);
+
 #endif /* _UIO_H_ */
@@ -22,6 +22,69 @@ void vm_bootstrap(void);
 /* Fault handling function called by trap code */
 int vm_fault(int faulttype, vaddr_t faultaddress);
 
+/*
+ * Shared zero frame. Reads of anonymous pages that were never written map
+ * this frame read-only; the first write gets a private frame.
+ */
+extern paddr_t vm_zeropage;
+extern unsigned vm_zeropage_maps;
+
+/*
+ * Commit accounting for anonymous memory.
+ *
+ *    vm_commit   - charge NPAGES against the commit limit. Returns ENOMEM
+ *                  if the overcommit policy refuses.
+ *    vm_uncommit - give NPAGES back.
+ *    vm_commitlimit - pages that may be committed under VM_OVERCOMMIT_NEVER.
+ *
+ * Policies:
+ *    VM_OVERCOMMIT_GUESS  - refuse only single requests larger than
+ *                           swap plus user memory (the default).
+ *    VM_OVERCOMMIT_ALWAYS - never refuse.
+ *    VM_OVERCOMMIT_NEVER  - refuse once the total committed would pass
+ *                           swap plus vm_overcommit_ratio percent of RAM.
+ */
+#define VM_OVERCOMMIT_GUESS     0
+#define VM_OVERCOMMIT_ALWAYS    1
+#define VM_OVERCOMMIT_NEVER     2
+
+extern int vm_overcommit_policy;
+extern unsigned vm_overcommit_ratio;
+extern unsigned vm_committed;
+
+int vm_commit(unsigned npages);
+void vm_uncommit(unsigned npages);
+unsigned vm_commitlimit(void);
+
+/*
+ * Out of memory handling, for faults that cannot get a frame or a swap
+ * slot even after evicting.
+ *
+ *    vm_oomkill - pick the address space with the most committed memory
+ *                 and mark it to exit on its next trap. Returns nonzero
+ *                 if the faulting address space should die itself.
+ *    vm_memwait - wait a while for the victim to give its memory back.
+ */
+struct addrspace;
+int vm_oomkill(struct addrspace *as);
+void vm_memwait(void);
+
+/*
+ * Fork admission. Kernel memory is never swapped, so a fork is refused
+ * unless the child's kernel side (address space, kernel stack and
+ * records, VM_FORKPAGES frames) fits in the free frames with
+ * vm_kernreserve frames to spare for page tables and kmalloc later on.
+ * The child's first write needs a user frame as well, either a free one
+ * or one evicted to a free swap slot.
+ *
+ *    vm_forkcheck - returns ENOMEM if a fork should not go ahead now.
+ */
+#define VM_FORKPAGES    4
+
+extern unsigned vm_kernreserve;
+
+int vm_forkcheck(void);
+
 /* Allocate/free kernel heap pages (called by kmalloc/kfree) */
 vaddr_t alloc_kpages(int npages);
 void free_kpages(vaddr_t addr);
@@ -0,0 +1,44 @@
+#ifndef ZSWAP_H
+#define ZSWAP_H
+
+#include <types.h>
+
+/*
+ * Compressed swap cache. Pages evicted to a swap slot are compressed into
+ * a fixed pool of kernel pages and only written to lhd0raw: when they do
+ * not fit. Entries are keyed by swap slot, so slots shared after a fork
+ * share the compressed copy too. All calls must hold swapmaplock.
+ *
+ *    zswap_store      - compress the page at KVADDR into the pool for SLOT.
+ *                       Returns ENOSPC if it does not compress well enough
+ *                       or the pool is full, the caller then goes to disk.
+ *    zswap_load       - decompress SLOT into KVADDR. Returns ENOENT if the
+ *                       slot is not in the pool.
+ *    zswap_invalidate - forget SLOT, called when the swap slot is freed.
+ */
+
+#define ZSWAP_POOLPAGES 16              // Kernel pages holding compressed data
+#define ZSWAP_CHUNK     64              // Allocation unit inside a pool page
+#define ZSWAP_MAXSIZE   (PAGE_SIZE / 2) // Pages that compress worse go to disk
+
+struct zswap_stats {
+    unsigned zs_stores;         // Pages kept in the pool
+    unsigned zs_rejected;       // Pages that did not compress well enough
+    unsigned zs_full;           // Pages that found no room in the pool
+    unsigned zs_hits;           // Swap ins served from the pool
+    unsigned zs_misses;         // Swap ins that went to disk
+    unsigned zs_bytesin;        // Uncompressed bytes stored
+    unsigned zs_bytesout;       // Compressed bytes stored
+    unsigned zs_poolused;       // Chunks currently in use
+};
+
+extern struct zswap_stats zswap_stats;
+extern int zswap_enabled;
+
+void zswap_bootstrap(void);
+int zswap_store(int slot, vaddr_t kvaddr);
+int zswap_load(int slot, vaddr_t kvaddr);
+void zswap_invalidate(int slot);
+void zswap_printstats(void);
+
+#endif /* ZSWAP_H */
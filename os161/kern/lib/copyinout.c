@@ -103,38 +103,48 @@ copycheck(const_userptr_t userptr, size_t len, size_t *stoplen) {
     return 0;
 }
 
+/*
+ * Quick form of copycheck for single blocks, which cannot be
+ * truncated: is the whole of [userptr, userptr+len) below USERTOP?
+ * Written so that it cannot overflow.
+ */
+static inline
+int
+copyblockok(const_userptr_t userptr, size_t len) {
+    return len <= USERTOP && (vaddr_t) userptr <= USERTOP - len;
+}
+
 /*
  * copyin
  *
  * Copy a block of memory of length LEN from user-level address USERSRC 
  * to kernel address DEST. We can use memcpy because it's protected by
  * the pcb_badfaultfunc/copyfail logic.
+ *
+ * The recovery setup is the expensive part of a small copy, so empty
+ * copies skip it, and the range check is done inline.
  */
 int
 copyin(const_userptr_t usersrc, void *dest, size_t len) {
-    int result;
-    size_t stoplen;
+    struct pcb *pcb = &curthread->t_pcb;
 
-    result = copycheck(usersrc, len, &stoplen);
-    if (result) {
-        return result;
-    }
-    if (stoplen != len) {
-        /* Single block, can't legally truncate it. */
+    if (!copyblockok(usersrc, len)) {
         return EFAULT;
     }
+    if (len == 0) {
+        return 0;
+    }
 
-    curthread->t_pcb.pcb_badfaultfunc = copyfail;
+    pcb->pcb_badfaultfunc = copyfail;
 
-    result = setjmp(curthread->t_pcb.pcb_copyjmp);
-    if (result) {
-        curthread->t_pcb.pcb_badfaultfunc = NULL;
+    if (setjmp(pcb->pcb_copyjmp)) {
+        pcb->pcb_badfaultfunc = NULL;
         return EFAULT;
     }
 
     memcpy(dest, (const void *) usersrc, len);
 
-    curthread->t_pcb.pcb_badfaultfunc = NULL;
+    pcb->pcb_badfaultfunc = NULL;
     return 0;
 }
 
@@ -147,35 +157,38 @@ copyin(const_userptr_t usersrc, void *dest, size_t len) {
  */
 int
 copyout(const void *src, userptr_t userdest, size_t len) {
-    int result;
-    size_t stoplen;
+    struct pcb *pcb = &curthread->t_pcb;
 
-    result = copycheck(userdest, len, &stoplen);
-    if (result) {
-        return result;
-    }
-    if (stoplen != len) {
-        /* Single block, can't legally truncate it. */
+    if (!copyblockok(userdest, len)) {
         return EFAULT;
     }
+    if (len == 0) {
+        return 0;
+    }
 
-    curthread->t_pcb.pcb_badfaultfunc = copyfail;
+    pcb->pcb_badfaultfunc = copyfail;
 
-    result = setjmp(curthread->t_pcb.pcb_copyjmp);
-    if (result) {
-        curthread->t_pcb.pcb_badfaultfunc = NULL;
+    if (setjmp(pcb->pcb_copyjmp)) {
+        pcb->pcb_badfaultfunc = NULL;
         return EFAULT;
     }
 
     memcpy((void *) userdest, src, len);
 
-    curthread->t_pcb.pcb_badfaultfunc = NULL;
+    pcb->pcb_badfaultfunc = NULL;
     return 0;
 }
 
+/*
+ * True if any byte of the word W is zero. (W - 0x01..01) borrows into
+ * the top bit of every byte that was zero; masking with ~W drops the
+ * bytes whose top bit was already set.
+ */
+#define HASZERO(w)  (((w) - 0x01010101U) & ~(w) & 0x80808080U)
+
 /*
  * Common string copying function that behaves the way that's desired
- * for copyinstr and copyoutstr.
+ * for copyinstr, copyoutstr and copystr.
  *
  * Copies a null-terminated string of maximum length MAXLEN from SRC
  * to DEST. If GOTLEN is not null, store the actual length found
@@ -188,38 +201,76 @@ copyout(const void *src, userptr_t userdest, size_t len) {
  * hit STOPLEN it's because the string has run into the end of
  * userspace. Thus in the latter case we return EFAULT, not 
  * ENAMETOOLONG.
+ *
+ * Once SRC is word aligned the string is scanned a word at a time,
+ * and a word with no null in it is copied whole. An aligned word
+ * never spans a page, so reading all of the word holding the null
+ * cannot fault where a byte at a time copy would not have.
  */
 static
 int
-copystr(char *dest, const char *src, size_t maxlen, size_t stoplen,
-        size_t *gotlen) {
-    size_t i;
-    for (i = 0; i < maxlen && i < stoplen; i++) {
+copystr_bounded(char *dest, const char *src, size_t maxlen, size_t stoplen,
+                size_t *gotlen) {
+    size_t i, limit;
+    u_int32_t w;
+
+    limit = maxlen < stoplen ? maxlen : stoplen;
+
+    for (i = 0; i < limit && (uintptr_t)(src + i) % 4 != 0; i++) {
+        dest[i] = src[i];
+        if (src[i] == 0) {
+            goto done;
+        }
+    }
+
+    while (i + 4 <= limit) {
+        w = *(const u_int32_t *)(src + i);
+        if (HASZERO(w)) {
+            break;
+        }
+        if ((uintptr_t)(dest + i) % 4 == 0) {
+            *(u_int32_t *)(dest + i) = w;
+        }
+        else {
+            dest[i] = src[i];
+            dest[i+1] = src[i+1];
+            dest[i+2] = src[i+2];
+            dest[i+3] = src[i+3];
+        }
+        i += 4;
+    }
+
+    for (; i < limit; i++) {
         dest[i] = src[i];
         if (src[i] == 0) {
-            if (gotlen != NULL) {
-                *gotlen = i + 1;
-            }
-            return 0;
+            goto done;
         }
     }
+
     if (stoplen < maxlen) {
         /* ran into user-kernel boundary */
         return EFAULT;
     }
     return ENAMETOOLONG;
+
+ done:
+    if (gotlen != NULL) {
+        *gotlen = i + 1;
+    }
+    return 0;
 }
 
 /*
  * copyinstr
  *
  * Copy a string from user-level address USERSRC to kernel address
- * DEST, as per copystr above. Uses the pcb_badfaultfunc/copyfail
+ * DEST, as per copystr_bounded above. Uses the pcb_badfaultfunc/copyfail
  * logic to protect against invalid addresses supplied by a user
  * process.
  */
 int
 copyinstr(const_userptr_t usersrc, char *dest, size_t len, size_t *actual) {
+    struct pcb *pcb = &curthread->t_pcb;
     int result;
     size_t stoplen;
 
@@ -228,17 +279,17 @@ copyinstr(const_userptr_t usersrc, char *dest, size_t len, size_t *actual) {
         return result;
     }
 
-    curthread->t_pcb.pcb_badfaultfunc = copyfail;
+    pcb->pcb_badfaultfunc = copyfail;
 
-    result = setjmp(curthread->t_pcb.pcb_copyjmp);
-    if (result) {
-        curthread->t_pcb.pcb_badfaultfunc = NULL;
+    if (setjmp(pcb->pcb_copyjmp)) {
+        pcb->pcb_badfaultfunc = NULL;
         return EFAULT;
     }
 
-    result = copystr(dest, (const char *) usersrc, len, stoplen, actual);
+    result = copystr_bounded(dest, (const char *) usersrc, len, stoplen,
+                             actual);
 
-    curthread->t_pcb.pcb_badfaultfunc = NULL;
+    pcb->pcb_badfaultfunc = NULL;
     return result;
 }
 
@@ -246,12 +297,13 @@ copyinstr(const_userptr_t usersrc, char *dest, size_t len, size_t *actual) {
  * copyoutstr
  *
  * Copy a string from kernel address SRC to user-level address
- * USERDEST, as per copystr above. Uses the pcb_badfaultfunc/copyfail
+ * USERDEST, as per copystr_bounded above. Uses the pcb_badfaultfunc/copyfail
  * logic to protect against invalid addresses supplied by a user
  * process.
  */
 int
 copyoutstr(const char *src, userptr_t userdest, size_t len, size_t *actual) {
+    struct pcb *pcb = &curthread->t_pcb;
     int result;
     size_t stoplen;
 
@@ -260,16 +312,26 @@ copyoutstr(const char *src, userptr_t userdest, size_t len, size_t *actual) {
         return result;
     }
 
-    curthread->t_pcb.pcb_badfaultfunc = copyfail;
+    pcb->pcb_badfaultfunc = copyfail;
 
-    result = setjmp(curthread->t_pcb.pcb_copyjmp);
-    if (result) {
-        curthread->t_pcb.pcb_badfaultfunc = NULL;
+    if (setjmp(pcb->pcb_copyjmp)) {
+        pcb->pcb_badfaultfunc = NULL;
         return EFAULT;
     }
 
-    result = copystr((char *) userdest, src, len, stoplen, actual);
+    result = copystr_bounded((char *) userdest, src, len, stoplen, actual);
 
-    curthread->t_pcb.pcb_badfaultfunc = NULL;
+    pcb->pcb_badfaultfunc = NULL;
     return result;
 }
+
+/*
+ * copystr
+ *
+ * Copy a string from kernel address SRC to kernel address DEST, as per
+ * copystr_bounded above. No fault protection is needed.
+ */
+int
+copystr(const char *src, char *dest, size_t len, size_t *actual) {
+    return copystr_bounded(dest, src, len, len, actual);
+}
@@ -17,6 +17,7 @@
 #include <syscall.h>
 #include <version.h>
 #include <coremap.h>
+#include <sysstat.h>
 
 /*
  * These two pieces of data are maintained by the makefiles and build system.
@@ -79,6 +80,7 @@ boot(void) {
     vm_bootstrap();
     kprintf_bootstrap();
     syscall_bootstrap();
+    sysstat_bootstrap();
     coremap_getkernelusage();
 
 
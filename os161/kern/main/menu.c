@@ -18,11 +18,22 @@
 #include "opt-sfs.h"
 #include "opt-net.h"
 #include "opt-dumbsynch.h"
+#include "opt-dumbvm.h"
+#include "opt-zswap.h"
 #include <machine/trapframe.h>
 #include <syscall.h>
 #include <machine/tlb.h>
 #include <coremap.h>
 #include <swapmap.h>
+#include <vm.h>
+#include <scheduler.h>
+#include <pid.h>
+#include <curthread.h>
+#include <generic/console.h>
+#include <sysstat.h>
+#if OPT_ZSWAP
+#include <zswap.h>
+#endif
 
 #define _PATH_SHELL "/bin/sh"
 
@@ -40,6 +51,16 @@ getinterval(time_t s1, u_int32_t ns1, time_t s2, u_int32_t ns2,
     *rs = s2 - s1;
 }
 
+u_int32_t
+usecs_since(time_t s1, u_int32_t ns1) {
+    time_t s2, secs;
+    u_int32_t ns2, nsecs;
+
+    gettime(&s2, &ns2);
+    getinterval(s1, ns1, s2, ns2, &secs, &nsecs);
+    return secs * 1000000 + nsecs / 1000;
+}
+
 ////////////////////////////////////////////////////////////
 //
 // Command menu functions 
@@ -101,8 +122,6 @@ common_prog(int nargs, char **args) {
             "synchronization-problems kernel.\n");
 #endif
     
-    P(pidlimit);
-    
     struct thread * childthread;
     result = thread_fork(args[0] /* thread name */,
             args /* thread arg */, nargs /* thread arg */,
@@ -114,13 +133,8 @@ common_prog(int nargs, char **args) {
     }
     
     
-    struct trapframe* tf = kmalloc(sizeof(struct trapframe));
-    int x;
-    tf->tf_a0 = childthread->pid;
-    tf->tf_a1 = (u_int32_t) &x;
-    tf->tf_a2 = 0;
-    sys_waitpid(tf,0);      // wait for the program to exit
-    kfree(tf);
+    int status;
+    proc_wait(curthread->t_proc, childthread->pid, &status);  // wait for the program to exit
     
     
     
@@ -382,6 +396,9 @@ cmd_coremap(int nargs, char **args) {
     (void) args;
 
     cm_print();
+    kprintf("Zero page read-only mappings: %d\n", vm_zeropage_maps);
+    kprintf("Zero pool: %d frames, %d hits, %d misses\n", ram_zeropool_size(),
+            ram_zeropool_hits, ram_zeropool_misses);
 
     return 0;
 }
@@ -398,6 +415,182 @@ cmd_swapmap(int nargs, char **args) {
     return 0;
 }
 
+#if !OPT_DUMBVM
+static
+int
+cmd_overcommit(int nargs, char **args) {
+    static const char *policies[] = { "guess", "always", "never" };
+    int i;
+
+    if (nargs > 3) {
+        kprintf("Usage: oc [guess|always|never] [ratio]\n");
+        return EINVAL;
+    }
+
+    if (nargs > 1) {
+        for (i = 0; i < 3; i++) {
+            if (!strcmp(args[1], policies[i])) break;
+        }
+        if (i == 3) {
+            kprintf("Usage: oc [guess|always|never] [ratio]\n");
+            return EINVAL;
+        }
+        vm_overcommit_policy = i;
+    }
+    if (nargs > 2) {
+        vm_overcommit_ratio = atoi(args[2]);
+    }
+
+    kprintf("Overcommit policy: %s, ratio %d%%\n",
+            policies[vm_overcommit_policy], vm_overcommit_ratio);
+    kprintf("Committed: %d pages, limit %d pages\n",
+            vm_committed, vm_commitlimit());
+
+    return 0;
+}
+#endif
+
+/*
+ * Fork admission limits: user processes in total, children per user
+ * process (for processes started from now on) and frames kept back
+ * for the kernel.
+ */
+static
+int
+cmd_proclimits(int nargs, char **args) {
+    if (nargs > 4) {
+        kprintf("Usage: pl [maxprocs] [maxchildren] [kernreserve]\n");
+        return EINVAL;
+    }
+
+    if (nargs > 1) proc_maxprocs = atoi(args[1]);
+    if (nargs > 2) proc_maxchildren = atoi(args[2]);
+#if !OPT_DUMBVM
+    if (nargs > 3) vm_kernreserve = atoi(args[3]);
+#endif
+
+    kprintf("User processes: %d of %d, %d children each\n",
+            proc_usercount(), proc_maxprocs, proc_maxchildren);
+#if !OPT_DUMBVM
+    kprintf("Free frames: %d, %d kept for the kernel, %d per fork\n",
+            cm_freeframes, vm_kernreserve, VM_FORKPAGES);
+    kprintf("Free swap slots: %d of %d\n", sm_freeslots, sm_pagecount);
+#endif
+
+    return 0;
+}
+
+static
+int
+cmd_quantum(int nargs, char **args) {
+    if (nargs > 2) {
+        kprintf("Usage: sq [ticks]\n");
+        return EINVAL;
+    }
+
+    if (nargs == 2) {
+        int ticks = atoi(args[1]);
+        if (ticks < 1) {
+            kprintf("Usage: sq [ticks]\n");
+            return EINVAL;
+        }
+        sched_quantum = ticks;
+    }
+
+    kprintf("Scheduler quantum: %d ticks (%d ms)\n", sched_quantum,
+            sched_quantum * 1000 / HZ);
+    kprintf("Context switches since boot: %u\n", thread_switchcount);
+
+    return 0;
+}
+
+static
+int
+cmd_constats(int nargs, char **args) {
+    (void) nargs;
+    (void) args;
+
+    con_printstats();
+    return 0;
+}
+
+static
+int
+cmd_sysstats(int nargs, char **args) {
+    (void) nargs;
+    (void) args;
+
+    sysstat_printstats();
+    return 0;
+}
+
+static
+int
+cmd_threadstats(int nargs, char **args) {
+    (void) nargs;
+    (void) args;
+
+    thread_printstats();
+    return 0;
+}
+
+#if OPT_ZSWAP
+static
+int
+cmd_zswapstats(int nargs, char **args) {
+    (void) nargs;
+    (void) args;
+
+    zswap_printstats();
+
+    return 0;
+}
+
+/*
+ * Runs a swap heavy program (triplehuge by default) with the compressed
+ * swap cache off and then on, and reports the time and cache statistics.
+ */
+static
+int
+cmd_zswapbench(int nargs, char **args) {
+    char progname[128] = "/testbin/triplehuge";
+    char *progargs[2];
+    time_t s1, s2, secs;
+    u_int32_t ns1, ns2, nsecs;
+    int pass, enabled = zswap_enabled;
+
+    if (nargs > 2) {
+        kprintf("Usage: zsb [program]\n");
+        return EINVAL;
+    }
+    if (nargs == 2) {
+        if (strlen(args[1]) >= sizeof(progname)) return EINVAL;
+        strcpy(progname, args[1]);
+    }
+    progargs[0] = progname;
+    progargs[1] = NULL;
+
+    for (pass = 0; pass < 2; pass++) {
+        // The pool usage is live state, everything else starts over
+        unsigned poolused = zswap_stats.zs_poolused;
+        bzero(&zswap_stats, sizeof(zswap_stats));
+        zswap_stats.zs_poolused = poolused;
+        zswap_enabled = pass;
+
+        gettime(&s1, &ns1);
+        common_prog(1, progargs);
+        gettime(&s2, &ns2);
+        getinterval(s1, ns1, s2, ns2, &secs, &nsecs);
+
+        kprintf("%s with zswap %s: %lu.%09lu seconds\n", progname,
+                pass ? "on" : "off", (unsigned long) secs, (unsigned long) nsecs);
+        zswap_printstats();
+    }
+
+    zswap_enabled = enabled;
+    return 0;
+}
+#endif
 
 ////////////////////////////////////////
 //
@@ -529,11 +722,23 @@ static const char *testmenu[] = {
     "[sy1] Semaphore test                ",
     "[sy2] Lock test             (1)     ",
     "[sy3] CV test               (1)     ",
+    "[sy4] Timeout test                  ",
+    "[syb] Synch benchmark               ",
+    "[scb] Scheduler benchmark           ",
+    "[jb] Thread join benchmark          ",
+    "[conb] Console output benchmark     ",
+    "[cpb] Copy bandwidth benchmark      ",
     "[fs1] Filesystem test               ",
     "[fs2] FS read stress        (4)     ",
     "[fs3] FS write stress       (4)     ",
     "[fs4] FS write stress 2     (4)     ",
     "[fs5] FS create stress      (4)     ",
+#if !OPT_DUMBVM
+    "[cmb] Coremap benchmark             ",
+#endif
+#if OPT_ZSWAP
+    "[zsb] Compressed swap benchmark     ",
+#endif
     NULL
 };
 
@@ -563,6 +768,17 @@ static const char *mainmenu[] = {
 #endif
     "[kh] Kernel heap stats              ",
     "[cm] View Core Map                  ",
+#if !OPT_DUMBVM
+    "[oc] Overcommit policy              ",
+#endif
+#if OPT_ZSWAP
+    "[zs] Compressed swap stats          ",
+#endif
+    "[pl] Process limits                 ",
+    "[sq] Scheduler quantum              ",
+    "[ts] Thread CPU accounting          ",
+    "[cs] Console stats                  ",
+    "[ss] Syscall stats                  ",
     "[q] Quit and shut down              ",
     "[tlb] Print TLB                     ",
     NULL
@@ -621,6 +837,17 @@ static struct {
     { "kh", cmd_kheapstats},
     { "cm", cmd_coremap},
     { "sm", cmd_swapmap},
+#if !OPT_DUMBVM
+    { "oc", cmd_overcommit},
+#endif
+#if OPT_ZSWAP
+    { "zs", cmd_zswapstats},
+#endif
+    { "pl", cmd_proclimits},
+    { "sq", cmd_quantum},
+    { "ts", cmd_threadstats},
+    { "cs", cmd_constats},
+    { "ss", cmd_sysstats},
     { "tlb", cmd_TLB},
 
     /* base system tests */
@@ -640,6 +867,7 @@ static struct {
     /* synchronization assignment tests */
     { "sy2", locktest},
     { "sy3", cvtest},
+    { "sy4", timeouttest},
 
     /* file system assignment tests */
     { "fs1", fstest},
@@ -648,6 +876,19 @@ static struct {
     { "fs4", writestress2},
     { "fs5", createstress},
 
+    /* benchmarks */
+    { "syb", synchbench},
+    { "scb", schedbench},
+    { "jb", joinbench},
+    { "conb", consolebench},
+    { "cpb", copybench},
+#if !OPT_DUMBVM
+    { "cmb", coremapbench},
+#endif
+#if OPT_ZSWAP
+    { "zsb", cmd_zswapbench},
+#endif
+
     { NULL, NULL}
 };
 
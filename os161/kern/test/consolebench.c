@@ -0,0 +1,75 @@
+/*
+ * Console output benchmark.
+ *
+ * Prints the same block of text twice: first with the output ring
+ * turned off, so putch waits for every character to be sent as it used
+ * to, and then with it on. For each run it reports how long the writer
+ * took to get its text out of its hands, how long until the device had
+ * sent it all, the resulting characters per second, and how much of
+ * the writer's time went on waiting for the console.
+ */
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <generic/console.h>
+#include <test.h>
+
+#define NLINES      48
+#define LINELEN     64
+
+static
+void
+conrun(int ring) {
+    char line[LINELEN + 1];
+    time_t secs;
+    u_int32_t nsecs, writeus, totalus;
+    unsigned waits, waitus, nchars = NLINES * LINELEN;
+    int i, j;
+
+    con_flush();
+    con_txring = ring;
+    waits = con_stats.cs_waits;
+    waitus = con_stats.cs_waitusecs;
+
+    gettime(&secs, &nsecs);
+    for (i = 0; i < NLINES; i++) {
+        snprintf(line, sizeof(line), "consolebench %2d ", i);
+        for (j = strlen(line); j < LINELEN - 1; j++) {
+            line[j] = 'a' + (i + j) % 26;
+        }
+        line[LINELEN - 1] = '\n';
+        line[LINELEN] = 0;
+        for (j = 0; j < LINELEN; j++) {
+            putch(line[j]);
+        }
+    }
+    writeus = usecs_since(secs, nsecs);
+    con_flush();
+    totalus = usecs_since(secs, nsecs);
+
+    waits = con_stats.cs_waits - waits;
+    waitus = con_stats.cs_waitusecs - waitus;
+
+    con_txring = 1;
+    kprintf("ring %s: %u chars, writer done in %u us, sent in %u us, "
+            "%u chars/sec\n", ring ? "on" : "off", nchars, writeus,
+            totalus, totalus ? nchars * 1000 / (totalus / 1000 + 1) : 0);
+    kprintf("  writer waited %u times, %u us (%u%% of its time)\n",
+            waits, waitus, writeus ? waitus / (writeus / 100 + 1) : 0);
+}
+
+int
+consolebench(int nargs, char **args) {
+    int ring = con_txring;
+
+    (void) nargs;
+    (void) args;
+
+    conrun(0);
+    conrun(1);
+    con_txring = ring;
+
+    con_printstats();
+    kprintf("Console benchmark done.\n");
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copy bandwidth benchmark.
+ *
+ * Times memcpy, the routine copyin and copyout use once their fault
+ * recovery is set up, at several block sizes with the source and
+ * destination both aligned, equally misaligned and misaligned relative
+ * to each other. A plain byte loop is timed alongside for comparison.
+ * Then times copystr, the string copier behind copyinstr, on strings of
+ * a few lengths. Pass a byte count to move more or less per case.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <clock.h>
+#include <test.h>
+
+#define COPYBYTES   (256 * 1024)
+#define MAXBLOCK    4096
+
+static const size_t blocksizes[] = { 16, 64, 256, 1024, 4096 };
+static const size_t strlens[] = { 8, 32, 128, 1024 };
+static const struct {
+    int src, dst;
+    const char *name;
+} aligns[] = {
+    { 0, 0, "aligned" },
+    { 1, 1, "both +1" },
+    { 0, 1, "skewed" },
+};
+
+#define NELEMS(a)   (sizeof(a) / sizeof((a)[0]))
+
+static
+u_int32_t
+kbpersec(u_int32_t bytes, u_int32_t usecs) {
+    if (usecs < 1000) {
+        usecs = 1000;
+    }
+    return (bytes / 1024) * 1000 / (usecs / 1000);
+}
+
+static
+void
+bytecopy(char *d, const char *s, size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        d[i] = s[i];
+    }
+}
+
+// Times COPYBYTES of SIZE byte copies, with memcpy or the byte loop
+static
+u_int32_t
+timecopy(char *dst, const char *src, size_t size, u_int32_t total,
+         int bytes) {
+    time_t secs;
+    u_int32_t nsecs, done;
+
+    gettime(&secs, &nsecs);
+    for (done = 0; done < total; done += size) {
+        if (bytes) {
+            bytecopy(dst, src, size);
+        }
+        else {
+            memcpy(dst, src, size);
+        }
+    }
+    return usecs_since(secs, nsecs);
+}
+
+int
+copybench(int nargs, char **args) {
+    u_int32_t total = COPYBYTES, usecs, byteusecs;
+    char *src, *dst;
+    size_t got;
+    unsigned i, j;
+    int result;
+
+    if (nargs > 1) {
+        total = atoi(args[1]);
+    }
+    if (total < MAXBLOCK) {
+        total = MAXBLOCK;
+    }
+
+    src = kmalloc(MAXBLOCK + 8);
+    dst = kmalloc(MAXBLOCK + 8);
+    if (src == NULL || dst == NULL) {
+        kprintf("copybench: Out of memory\n");
+        kfree(src);
+        kfree(dst);
+        return ENOMEM;
+    }
+    for (i = 0; i < MAXBLOCK + 8; i++) {
+        src[i] = 'a' + i % 26;
+    }
+
+    kprintf("memcpy, %u bytes per case, KB/s memcpy / byte loop:\n", total);
+    for (j = 0; j < NELEMS(aligns); j++) {
+        kprintf("  %-8s", aligns[j].name);
+        for (i = 0; i < NELEMS(blocksizes); i++) {
+            char *d = dst + aligns[j].dst;
+            const char *s = src + aligns[j].src;
+
+            usecs = timecopy(d, s, blocksizes[i], total, 0);
+            byteusecs = timecopy(d, s, blocksizes[i], total, 1);
+            kprintf(" %4u: %u/%u", blocksizes[i], kbpersec(total, usecs),
+                    kbpersec(total, byteusecs));
+        }
+        kprintf("\n");
+    }
+
+    kprintf("copystr, KB/s aligned / +1:\n ");
+    for (i = 0; i < NELEMS(strlens); i++) {
+        kprintf(" %4u:", strlens[i]);
+        for (j = 0; j < 2; j++) {
+            time_t secs;
+            u_int32_t nsecs, done;
+            char *s = src + j;
+            char save = s[strlens[i] - 1];
+
+            s[strlens[i] - 1] = 0;
+            gettime(&secs, &nsecs);
+            for (done = 0; done < total; done += strlens[i]) {
+                result = copystr(s, dst, MAXBLOCK, &got);
+                assert(result == 0 && got == strlens[i]);
+            }
+            usecs = usecs_since(secs, nsecs);
+            s[strlens[i] - 1] = save;
+            kprintf(" %u%s", kbpersec(total, usecs), j ? "" : " /");
+        }
+    }
+    kprintf("\n");
+
+    kfree(src);
+    kfree(dst);
+    kprintf("Copy benchmark done.\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Coremap benchmark.
+ *
+ * Reports how much memory the coremap metadata takes and how long it
+ * takes to scan it, compared with the old layout of six full words per
+ * frame (address, user, pid, use count, virtual address and length).
+ */
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <vm.h>
+#include <addrspace.h>
+#include <coremap.h>
+#include <machine/spl.h>
+#include <test.h>
+
+#define NSCANS      200
+#define NALLOCS     2000
+
+/* The coremap entry as it used to be laid out */
+struct old_coremap_entry {
+    paddr_t addr;
+    unsigned usedby;
+    unsigned pid;
+    unsigned usecount;
+    vaddr_t vaddr;
+    unsigned length;
+};
+
+int
+coremapbench(int nargs, char **args) {
+    struct old_coremap_entry *old;
+    time_t secs;
+    u_int32_t nsecs, oldtime, newtime;
+    unsigned i, j, nfree;
+    int spl;
+
+    (void) nargs;
+    (void) args;
+
+    unsigned oldsize = sizeof(struct old_coremap_entry);
+    unsigned newsize = sizeof(struct coremap_entry);
+    unsigned rmapsize = sizeof(struct coremap_rmap);
+
+    kprintf("Coremap benchmark: %d frames\n", cm_totalframes);
+    kprintf("  old layout: %d bytes/frame, %d bytes total\n",
+            oldsize, oldsize * cm_totalframes);
+    kprintf("  new layout: %d+%d bytes/frame, %d bytes total (%d scanned)\n",
+            newsize, rmapsize, (newsize + rmapsize) * cm_totalframes,
+            newsize * cm_totalframes);
+
+    old = kmalloc(cm_totalframes * sizeof(struct old_coremap_entry));
+    if (old == NULL) {
+        kprintf("coremapbench: Out of memory\n");
+        return 0;
+    }
+
+    spl = splhigh();
+    for (i = 0; i < cm_totalframes; i++) {
+        old[i].addr = cm_getaddressfromframe(i);
+        old[i].usedby = coremap[i].usedby;
+        old[i].pid = cm_rmap[i].pid;
+        old[i].usecount = coremap[i].usecount;
+        old[i].vaddr = cm_rmap[i].vpn << 12;
+        old[i].length = coremap[i].cont ? 0 : 1;
+    }
+
+    // Free frame scans, the inner loop of ram_borrowmem
+    gettime(&secs, &nsecs);
+    for (j = 0, nfree = 0; j < NSCANS; j++) {
+        for (i = 0; i < cm_totalframes; i++) {
+            if (old[i].usedby == CM_FREE) nfree++;
+        }
+    }
+    oldtime = usecs_since(secs, nsecs);
+
+    gettime(&secs, &nsecs);
+    for (j = 0, nfree = 0; j < NSCANS; j++) {
+        for (i = 0; i < cm_totalframes; i++) {
+            if (coremap[i].usedby == CM_FREE) nfree++;
+        }
+    }
+    newtime = usecs_since(secs, nsecs);
+    splx(spl);
+
+    kfree(old);
+
+    kprintf("  %d full scans: old %u us, new %u us (%d free frames)\n",
+            NSCANS, oldtime, newtime, nfree / NSCANS);
+
+    // Kernel page allocate/free cycles, which no longer scan on free
+    gettime(&secs, &nsecs);
+    for (j = 0; j < NALLOCS; j++) {
+        vaddr_t page = alloc_kpages(1);
+        if (page == 0) {
+            kprintf("coremapbench: alloc_kpages failed\n");
+            break;
+        }
+        free_kpages(page);
+    }
+    newtime = usecs_since(secs, nsecs);
+    kprintf("  %d alloc_kpages/free_kpages pairs: %u us\n", j, newtime);
+
+    kprintf("Coremap benchmark done.\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Thread join benchmark.
+ *
+ * Forks kernel threads in batches and joins them, checking that every
+ * exit value comes back to the right joiner, and reports how many
+ * fork/join round trips per second the thread system manages, first
+ * with the dead thread cache turned off and then with it on. Pass a
+ * thread count to run more or fewer than the default.
+ */
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <thread.h>
+#include <test.h>
+
+#define NJOINS      2000
+#define BATCH       32
+
+static
+void
+jointhread(void *junk, unsigned long num) {
+    (void) junk;
+
+    // Odd threads yield first, so some joins block and some do not
+    if (num & 1) {
+        thread_yield();
+    }
+    thread_exitval(num);
+}
+
+/*
+ * Forks and joins COUNT threads, BATCH at a time, and prints the rate.
+ * Returns the number of wrong exit values.
+ */
+static
+int
+joinrun(const char *what, int count) {
+    struct thread *threads[BATCH];
+    time_t secs;
+    u_int32_t nsecs, usecs, msecs;
+    unsigned switches, hits, misses;
+    int done, n, i, result, bad = 0;
+
+    switches = thread_switchcount;
+    hits = thread_cache_hits;
+    misses = thread_cache_misses;
+    gettime(&secs, &nsecs);
+
+    for (done = 0; done < count; done += n) {
+        n = count - done < BATCH ? count - done : BATCH;
+        for (i = 0; i < n; i++) {
+            result = thread_fork_joinable("joinbench", NULL, done + i,
+                    jointhread, &threads[i]);
+            if (result) {
+                panic("joinbench: thread_fork failed: %s\n",
+                        strerror(result));
+            }
+        }
+        for (i = 0; i < n; i++) {
+            if (thread_join(threads[i]) != done + i) {
+                bad++;
+            }
+        }
+    }
+
+    usecs = usecs_since(secs, nsecs);
+    switches = thread_switchcount - switches;
+    hits = thread_cache_hits - hits;
+    misses = thread_cache_misses - misses;
+    msecs = usecs / 1000 ? usecs / 1000 : 1;
+
+    kprintf("  %s: %d fork/join pairs in %u.%06u seconds, %u/sec, "
+            "%u us each\n", what, count, usecs / 1000000, usecs % 1000000,
+            (u_int32_t) count * 1000 / msecs, count ? usecs / count : 0);
+    kprintf("  %s: %u context switches, %u per join, "
+            "thread cache hit rate %u%%\n", what, switches,
+            count ? switches / count : 0,
+            hits + misses ? hits * 100 / (hits + misses) : 0);
+
+    return bad;
+}
+
+int
+joinbench(int nargs, char **args) {
+    int count = NJOINS, bad, enabled = thread_cache_enabled;
+
+    if (nargs > 1) {
+        count = atoi(args[1]);
+    }
+
+    kprintf("Thread join benchmark: %d threads, %d at a time\n",
+            count, BATCH);
+
+    thread_cache_enabled = 0;
+    bad = joinrun("no cache", count);
+    thread_cache_enabled = 1;
+    bad += joinrun("cached", count);
+    thread_cache_enabled = enabled;
+
+    if (bad) {
+        kprintf("  %d threads returned the wrong exit value\n", bad);
+    }
+    kprintf("Thread join benchmark %s.\n", bad ? "FAILED" : "done");
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Scheduler benchmark.
+ *
+ * Runs a mix of CPU bound batch threads and one interactive thread that
+ * sleeps on lbolt and does a little work each time it wakes. Reports how
+ * long the interactive thread took to get the processor after each
+ * wakeup, and how long the batch work took to finish. Run it on a round
+ * robin kernel and an "options mlfq" kernel to compare.
+ *
+ * Before that a single batch thread runs alone, to show how many context
+ * switches the clock causes when there is nobody to switch to.
+ */
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <thread.h>
+#include <scheduler.h>
+#include <synch.h>
+#include <machine/spl.h>
+#include <test.h>
+#include "opt-mlfq.h"
+
+#define NBATCH          8
+#define BATCHLOOPS      1500000
+#define NWAKEUPS        5
+
+static struct semaphore *benchdone;
+static volatile int batchrunning;
+static u_int32_t maxlatency, totallatency;
+
+static
+void
+batchthread(void *junk, unsigned long num) {
+    volatile unsigned i;
+
+    (void) junk;
+    (void) num;
+
+    for (i = 0; i < BATCHLOOPS; i++);
+
+    int spl = splhigh();
+    batchrunning--;
+    splx(spl);
+    V(benchdone);
+}
+
+static
+void
+switchrate(const char *what, unsigned switches, u_int32_t usecs) {
+    u_int32_t msecs = usecs / 1000;
+
+    kprintf("  %s: %u context switches in %u ms, %u/sec\n", what,
+            switches, msecs, msecs ? switches * 1000 / msecs : 0);
+}
+
+static
+void
+interactivethread(void *junk, unsigned long num) {
+    volatile unsigned j;
+    int i, spl;
+
+    (void) junk;
+    (void) num;
+
+    for (i = 0; i < NWAKEUPS; i++) {
+        spl = splhigh();
+        thread_sleep(&lbolt);
+        u_int32_t latency = usecs_since(lbolt_secs, lbolt_nsecs);
+        splx(spl);
+
+        totallatency += latency;
+        if (latency > maxlatency) maxlatency = latency;
+
+        // A keystroke worth of work
+        for (j = 0; j < 2000; j++);
+    }
+    V(benchdone);
+}
+
+int
+schedbench(int nargs, char **args) {
+    time_t secs;
+    u_int32_t nsecs, batchtime = 0;
+    unsigned switches;
+    int i, result, ndone;
+
+    (void) nargs;
+    (void) args;
+
+    if (benchdone == NULL) {
+        benchdone = sem_create("schedbench", 0);
+        if (benchdone == NULL) {
+            panic("schedbench: sem_create failed\n");
+        }
+    }
+
+    kprintf("Scheduler benchmark (%s, quantum %d ticks)\n",
+            OPT_MLFQ ? "mlfq" : "round robin", sched_quantum);
+
+    batchrunning = 1;
+    switches = thread_switchcount;
+    gettime(&secs, &nsecs);
+    result = thread_fork("schedbench solo", NULL, 0, batchthread, NULL);
+    if (result) {
+        panic("schedbench: thread_fork failed: %s\n", strerror(result));
+    }
+    P(benchdone);
+    switchrate("1 batch thread alone", thread_switchcount - switches,
+            usecs_since(secs, nsecs));
+
+    kprintf("  %d batch threads, 1 interactive\n", NBATCH);
+    maxlatency = totallatency = 0;
+    batchrunning = NBATCH;
+    switches = thread_switchcount;
+    gettime(&secs, &nsecs);
+
+    result = thread_fork("schedbench interactive", NULL, 0,
+            interactivethread, NULL);
+    if (result) {
+        panic("schedbench: thread_fork failed: %s\n", strerror(result));
+    }
+    for (i = 0; i < NBATCH; i++) {
+        result = thread_fork("schedbench batch", NULL, i, batchthread, NULL);
+        if (result) {
+            panic("schedbench: thread_fork failed: %s\n", strerror(result));
+        }
+    }
+
+    for (ndone = 0; ndone < NBATCH + 1; ndone++) {
+        P(benchdone);
+        if (batchrunning == 0 && batchtime == 0) {
+            batchtime = usecs_since(secs, nsecs);
+        }
+    }
+
+    kprintf("  interactive wakeup latency: avg %u us, max %u us\n",
+            totallatency / NWAKEUPS, maxlatency);
+    kprintf("  batch work finished in %u.%06u seconds\n",
+            batchtime / 1000000, batchtime % 1000000);
+    switchrate("mixed load", thread_switchcount - switches,
+            usecs_since(secs, nsecs));
+    kprintf("Scheduler benchmark done.\n");
+
+    return 0;
+}
@@ -7,7 +7,10 @@
 #include <synch.h>
 #include <thread.h>
 #include <test.h>
+#include <machine/spl.h>
 #include <clock.h>
+#include <timer.h>
+#include <kern/errno.h>
 
 #define NSEMLOOPS     63
 #define NLOCKLOOPS    120
@@ -273,3 +276,248 @@ cvtest(int nargs, char **args)
 
 	return 0;
 }
+
+/*
+ * Timeout test. Timed P and cv_wait must give up no sooner than asked
+ * when nothing comes, and return early when something does. Then a
+ * crowd of threads sleeps for lengths either side of the first level
+ * of the timer wheel, so some are cascaded, and each must wake no
+ * sooner than asked.
+ */
+
+static const u_int32_t sleepticks[] = {
+	0, 1, 2, 3, 50, 100, 200, 255, 256, 257, 300, 400, 511, 512, 513, 600,
+};
+#define NSLEEPERS (sizeof(sleepticks) / sizeof(sleepticks[0]))
+
+static struct semaphore *timeoutsem;
+
+static
+void
+timeoutwaker(void *junk, unsigned long usecv)
+{
+	(void)junk;
+
+	timer_sleep(2);
+	if (usecv) {
+		lock_acquire(testlock);
+		testval1 = 1;
+		cv_signal(testcv, testlock);
+		lock_release(testlock);
+	}
+	else {
+		V(timeoutsem);
+	}
+}
+
+static
+void
+timeoutsleeper(void *junk, unsigned long num)
+{
+	u_int32_t start, late;
+	int spl;
+
+	(void)junk;
+
+	start = clock_ticks;
+	timer_sleep(sleepticks[num]);
+	late = clock_ticks - start;
+	if (late < sleepticks[num]) {
+		panic("timeouttest: %u tick sleep woke after %u\n",
+		      sleepticks[num], late);
+	}
+	late -= sleepticks[num];
+
+	spl = splhigh();
+	if (late > testval2) {
+		testval2 = late;
+	}
+	splx(spl);
+	V(donesem);
+}
+
+static
+void
+timeoutcheck(const char *what, int result, int want, u_int32_t start,
+	     u_int32_t minticks, u_int32_t maxticks)
+{
+	u_int32_t ticks = clock_ticks - start;
+
+	if (result != want) {
+		panic("timeouttest: %s returned %d, expected %d\n",
+		      what, result, want);
+	}
+	if (ticks < minticks || ticks > maxticks) {
+		panic("timeouttest: %s took %u ticks, expected %u to %u\n",
+		      what, ticks, minticks, maxticks);
+	}
+	kprintf("  %s: %u ticks\n", what, ticks);
+}
+
+int
+timeouttest(int nargs, char **args)
+{
+	u_int32_t start, want = mstoticks(100), never = mstoticks(5000);
+	unsigned i;
+	int result;
+
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	if (timeoutsem == NULL) {
+		timeoutsem = sem_create("timeoutsem", 0);
+		if (timeoutsem == NULL) {
+			panic("timeouttest: sem_create failed\n");
+		}
+	}
+	kprintf("Starting timeout test...\n");
+
+	start = clock_ticks;
+	result = P_timeout(timeoutsem, 100);
+	timeoutcheck("P, 100 ms, no V", result, ETIMEDOUT, start, want, never);
+
+	result = thread_fork("timeoutwaker", NULL, 0, timeoutwaker, NULL);
+	if (result) {
+		panic("timeouttest: thread_fork failed: %s\n",
+		      strerror(result));
+	}
+	start = clock_ticks;
+	result = P_timeout(timeoutsem, 5000);
+	timeoutcheck("P, 5 s, V after 2 ticks", result, 0, start, 0, never - 1);
+
+	lock_acquire(testlock);
+	start = clock_ticks;
+	result = cv_wait_timeout(testcv, testlock, 100);
+	assert(lock_do_i_hold(testlock));
+	timeoutcheck("cv_wait, 100 ms, no signal", result, ETIMEDOUT, start,
+		     want, never);
+
+	/* The waker cannot signal until we wait, we hold the lock */
+	testval1 = 0;
+	result = thread_fork("timeoutwaker", NULL, 1, timeoutwaker, NULL);
+	if (result) {
+		panic("timeouttest: thread_fork failed: %s\n",
+		      strerror(result));
+	}
+	start = clock_ticks;
+	while (testval1 == 0 && result == 0) {
+		result = cv_wait_timeout(testcv, testlock, 5000);
+	}
+	assert(lock_do_i_hold(testlock));
+	lock_release(testlock);
+	timeoutcheck("cv_wait, 5 s, signal after 2 ticks", result, 0, start,
+		     0, never - 1);
+
+	testval2 = 0;
+	for (i=0; i<NSLEEPERS; i++) {
+		result = thread_fork("timeoutsleeper", NULL, i,
+				     timeoutsleeper, NULL);
+		if (result) {
+			panic("timeouttest: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	for (i=0; i<NSLEEPERS; i++) {
+		P(donesem);
+	}
+	kprintf("  %u sleepers of up to %u ticks: at most %lu ticks late\n",
+		NSLEEPERS, sleepticks[NSLEEPERS - 1], testval2);
+
+	kprintf("Timeout test done\n");
+
+	return 0;
+}
+
+/*
+ * Synch benchmark. Threads hammer one lock (or a semaphore used as a
+ * mutex), yielding while they hold it so the others pile up behind them,
+ * and we report how many context switches each acquire cost.
+ */
+
+#define NBENCHLOOPS   50
+
+static struct semaphore *benchsem;
+
+static
+void
+synchbenchthread(void *junk, unsigned long usesem)
+{
+	int i;
+
+	(void)junk;
+
+	for (i=0; i<NBENCHLOOPS; i++) {
+		if (usesem) {
+			P(benchsem);
+		}
+		else {
+			lock_acquire(testlock);
+		}
+
+		testval1++;
+		thread_yield();
+
+		if (usesem) {
+			V(benchsem);
+		}
+		else {
+			lock_release(testlock);
+		}
+	}
+	V(donesem);
+}
+
+int
+synchbench(int nargs, char **args)
+{
+	static const int nthreads[] = { 2, 8, 32 };
+	unsigned start, switches, acquires;
+	int i, j, usesem, result;
+
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	if (benchsem==NULL) {
+		benchsem = sem_create("benchsem", 1);
+		if (benchsem == NULL) {
+			panic("synchbench: sem_create failed\n");
+		}
+	}
+
+	kprintf("Starting synch benchmark...\n");
+
+	for (usesem=0; usesem<2; usesem++) {
+		for (j=0; j<3; j++) {
+			testval1 = 0;
+			start = thread_switchcount;
+
+			for (i=0; i<nthreads[j]; i++) {
+				result = thread_fork("synchbench", NULL, usesem,
+						     synchbenchthread, NULL);
+				if (result) {
+					panic("synchbench: thread_fork failed: %s\n",
+					      strerror(result));
+				}
+			}
+			for (i=0; i<nthreads[j]; i++) {
+				P(donesem);
+			}
+
+			switches = thread_switchcount - start;
+			acquires = nthreads[j] * NBENCHLOOPS;
+			assert(testval1 == acquires);
+
+			kprintf("  %s, %2d threads: %u acquires, %u switches, "
+				"%u.%02u per acquire\n",
+				usesem ? "semaphore" : "lock     ", nthreads[j],
+				acquires, switches, switches / acquires,
+				(switches % acquires) * 100 / acquires);
+		}
+	}
+
+	kprintf("Synch benchmark done.\n");
+
+	return 0;
+}
@@ -2,15 +2,29 @@
 #include <lib.h>
 #include <machine/spl.h>
 #include <thread.h>
+#include <curthread.h>
 #include <clock.h>
+#include <scheduler.h>
+#include <timer.h>
 
 /* 
  * The address of lbolt has thread_wakeup called on it once a second.
  */
 int lbolt;
 
+/* When lbolt was last woken, for measuring wakeup latency. */
+time_t lbolt_secs;
+u_int32_t lbolt_nsecs;
+
 static int lbolt_counter;
 
+/* Time slice in ticks, see scheduler.h. */
+int sched_quantum = SCHED_QUANTUM;
+
+/* Ticks since boot, and ticks spent in the idle loop. */
+u_int32_t clock_ticks;
+u_int32_t idle_ticks;
+
 /*
  * This is called HZ times a second by the timer device setup.
  */
@@ -19,17 +33,31 @@ void
 hardclock(void)
 {
 	/*
-	 * Collect statistics here as desired.
+	 * Charge the tick to whoever it interrupted.
 	 */
-
+	clock_ticks++;
+	if (curthread == NULL) {
+		idle_ticks++;
+	}
+	else if (interrupted_user) {
+		curthread->t_rusage.ru_utime++;
+	}
+	else {
+		curthread->t_rusage.ru_stime++;
+	}
 
 	lbolt_counter++;
 	if (lbolt_counter >= HZ) {
 		lbolt_counter = 0;
+		gettime(&lbolt_secs, &lbolt_nsecs);
 		thread_wakeup(&lbolt);
 	}
 
-	thread_yield();
+	timer_tick();
+
+	if (scheduler_tick()) {
+		thread_yield();
+	}
 }
 
 /*
@@ -38,12 +66,5 @@ hardclock(void)
 void
 clocksleep(int num_secs)
 {
-	int s;
-
-	s = splhigh();
-	while (num_secs > 0) {
-		thread_sleep(&lbolt);
-		num_secs--;
-	}
-	splx(s);
+	timer_sleep(num_secs * HZ);
 }
@@ -0,0 +1,276 @@
+/*
+ * Multi-level feedback queue scheduler.
+ *
+ * There is one run queue per priority level and the scheduler always
+ * runs the first thread of the highest non-empty level. A thread that
+ * uses up its quantum drops a level, and lower levels get longer
+ * quanta, sched_quantum ticks at the top and twice as many each level
+ * down. A thread that blocks before then moves up a level when it
+ * wakes. This keeps the shell and console-bound programs ahead of CPU
+ * hogs. Every MLFQ_BOOST_TICKS everything is moved back to the top so
+ * long running threads cannot starve.
+ *
+ * Selected with "options mlfq" in the kernel config. The round robin
+ * scheduler in scheduler.c is used otherwise.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <scheduler.h>
+#include <thread.h>
+#include <curthread.h>
+#include <machine/spl.h>
+#include <queue.h>
+#include <clock.h>
+#include <vm.h>
+
+#define MLFQ_LEVELS		4
+#define MLFQ_QUANTUM(level)	(sched_quantum << (level))
+#define MLFQ_BOOST_TICKS	HZ		/* once a second */
+
+/*
+ *  Scheduler data
+ */
+
+// One queue of runnable threads per level, 0 is the highest priority
+static struct queue *runqueues[MLFQ_LEVELS];
+
+// Ticks since the last priority boost
+static int boost_ticks;
+
+/*
+ * Setup function
+ */
+void
+scheduler_bootstrap(void)
+{
+	int i;
+
+	for (i = 0; i < MLFQ_LEVELS; i++) {
+		runqueues[i] = q_create(32);
+		if (runqueues[i] == NULL) {
+			panic("scheduler: Could not create run queue\n");
+		}
+	}
+	boost_ticks = 0;
+}
+
+/*
+ * Ensure space for handling at least NTHREADS threads. Every thread may
+ * end up on any level, so each queue gets the full amount.
+ */
+int
+scheduler_preallocate(int nthreads)
+{
+	int i, result;
+
+	assert(curspl>0);
+	for (i = 0; i < MLFQ_LEVELS; i++) {
+		result = q_preallocate(runqueues[i], nthreads);
+		if (result) {
+			return result;
+		}
+	}
+	return 0;
+}
+
+/*
+ * This is called during panic shutdown to dispose of threads other
+ * than the one invoking panic. We drop them on the floor instead of
+ * cleaning them up properly; since we're about to go down it doesn't
+ * really matter, and freeing everything might cause further panics.
+ */
+void
+scheduler_killall(void)
+{
+	int i;
+
+	assert(curspl>0);
+	for (i = 0; i < MLFQ_LEVELS; i++) {
+		while (!q_empty(runqueues[i])) {
+			struct thread *t = q_remhead(runqueues[i]);
+			kprintf("scheduler: Dropping thread %s.\n", t->t_name);
+		}
+	}
+}
+
+/*
+ * Cleanup function.
+ *
+ * The queue objects to being destroyed if it's got stuff in it.
+ * Use scheduler_killall to make sure this is the case. During
+ * ordinary shutdown, normally it should be.
+ */
+void
+scheduler_shutdown(void)
+{
+	int i;
+
+	scheduler_killall();
+
+	assert(curspl>0);
+	for (i = 0; i < MLFQ_LEVELS; i++) {
+		q_destroy(runqueues[i]);
+		runqueues[i] = NULL;
+	}
+}
+
+/*
+ * Returns the highest level with a runnable thread, or -1.
+ */
+static
+int
+highest_level(void)
+{
+	int i;
+
+	for (i = 0; i < MLFQ_LEVELS; i++) {
+		if (!q_empty(runqueues[i])) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Actual scheduler. Returns the next thread to run.  Calls cpu_idle()
+ * if there's nothing ready. (Note: cpu_idle must be called in a loop
+ * until something's ready - it doesn't know whether the things that
+ * wake it up are going to make a thread runnable or not.)
+ */
+struct thread *
+scheduler(void)
+{
+	int level;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	while ((level = highest_level()) < 0) {
+		/*
+		 * Spend idle time zeroing free frames, one per pass, and
+		 * let waiting interrupts in after each so a refill does
+		 * not hold off the clock or console. Sleep when done.
+		 */
+		if (ram_prezero()) {
+			spl0();
+			splhigh();
+		}
+		else {
+			cpu_idle();
+		}
+	}
+
+	return q_remhead(runqueues[level]);
+}
+
+/*
+ * Make a thread runnable.
+ *
+ * A thread coming off a wait channel has t_woken set.
+ * It gave the processor up before its quantum ran out, so it moves up
+ * a level and starts a fresh quantum.
+ */
+int
+make_runnable(struct thread *t)
+{
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	if (t->t_woken) {
+		if (t->t_level > 0) {
+			t->t_level--;
+		}
+		t->t_ticks = 0;
+	}
+
+	return q_addtail(runqueues[t->t_level], t);
+}
+
+/*
+ * Move every runnable thread, and the current one, back to the top.
+ * Sleeping threads are left alone; they move up when they wake.
+ */
+static
+void
+mlfq_boost(void)
+{
+	int i, result;
+
+	for (i = 1; i < MLFQ_LEVELS; i++) {
+		while (!q_empty(runqueues[i])) {
+			struct thread *t = q_remhead(runqueues[i]);
+			t->t_level = 0;
+			t->t_ticks = 0;
+			/* Preallocated for every thread, cannot fail */
+			result = q_addtail(runqueues[0], t);
+			assert(result == 0);
+		}
+	}
+
+	if (curthread != NULL) {
+		curthread->t_level = 0;
+		curthread->t_ticks = 0;
+	}
+}
+
+/*
+ * Clock tick. Charges the tick to the current thread and decides
+ * whether it should be preempted: when its quantum is used up (it also
+ * drops a level) and something else is runnable, or when something at
+ * a higher level is waiting.
+ */
+int
+scheduler_tick(void)
+{
+	struct thread *cur = curthread;
+	int level;
+
+	assert(curspl>0);
+
+	if (++boost_ticks >= MLFQ_BOOST_TICKS) {
+		boost_ticks = 0;
+		mlfq_boost();
+	}
+
+	/* Idle loop */
+	if (cur == NULL) {
+		return 0;
+	}
+
+	if (++cur->t_ticks >= MLFQ_QUANTUM(cur->t_level)) {
+		cur->t_ticks = 0;
+		if (cur->t_level < MLFQ_LEVELS - 1) {
+			cur->t_level++;
+		}
+		return highest_level() >= 0;
+	}
+
+	level = highest_level();
+	return level >= 0 && level < cur->t_level;
+}
+
+/*
+ * Debugging function to dump the run queues.
+ */
+void
+print_run_queue(void)
+{
+	/* Turn interrupts off so the whole list prints atomically. */
+	int spl = splhigh();
+
+	int i, level, k = 0;
+
+	for (level = 0; level < MLFQ_LEVELS; level++) {
+		struct queue *q = runqueues[level];
+		for (i = q_getstart(q); i != q_getend(q);
+		     i = (i+1) % q_getsize(q)) {
+			struct thread *t = q_getguy(q, i);
+			kprintf("  %2d: [%d] %s %p\n", k, level, t->t_name,
+				t->t_sleepaddr);
+			k++;
+		}
+	}
+
+	splx(spl);
+}
@@ -0,0 +1,265 @@
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <synch.h>
+#include <pid.h>
+
+#define PROC_BUCKETS 64
+#define PROC_HASH(pid) ((pid) % PROC_BUCKETS)
+#define DEBUG_PID 0
+
+static struct lock *proclock;
+static struct proc *proctable[PROC_BUCKETS];
+static int nprocs;
+static int nuserprocs;
+
+int proc_maxprocs = PROC_MAXPROCS;
+int proc_maxchildren = PROC_MAXCHILDREN;
+
+// One bit per pid, allocation resumes after the last pid handed out
+static u_int32_t pidmap[(PID_MAX + 32) / 32];
+static pid_t pidnext = PID_MIN;
+
+////////////////////////////////////////
+//
+// Pid bitmap
+
+static int pid_isset(pid_t pid) {
+    return (pidmap[pid / 32] >> (pid % 32)) & 1;
+}
+
+static void pid_set(pid_t pid, int used) {
+    if (used)
+        pidmap[pid / 32] |= (1 << (pid % 32));
+    else
+        pidmap[pid / 32] &= ~(1 << (pid % 32));
+}
+
+static int pid_alloc(pid_t *ret) {
+    pid_t pid = pidnext;
+    int n;
+
+    for (n = 0; n < PID_MAX - PID_MIN + 1; ) {
+        if (pidmap[pid / 32] == 0xffffffff) {
+            // Whole word in use, skip to the next one
+            n += 32 - pid % 32;
+            pid += 32 - pid % 32;
+        } else if (!pid_isset(pid)) {
+            pid_set(pid, 1);
+            pidnext = pid == PID_MAX ? PID_MIN : pid + 1;
+            *ret = pid;
+            return 0;
+        } else {
+            n++;
+            pid++;
+        }
+        if (pid > PID_MAX) pid = PID_MIN;
+    }
+    return EAGAIN;
+}
+
+////////////////////////////////////////
+//
+// Records
+
+static struct proc *proc_lookup(pid_t pid) {
+    struct proc *p;
+    for (p = proctable[PROC_HASH(pid)]; p != NULL; p = p->p_hashnext) {
+        if (p->p_pid == pid) return p;
+    }
+    return NULL;
+}
+
+// Takes P off its parent's child list
+static void proc_unlink(struct proc *p) {
+    if (p->p_parent != NULL)
+        p->p_parent->p_nchildren--;
+    if (p->p_sibprev != NULL)
+        p->p_sibprev->p_sibnext = p->p_sibnext;
+    else if (p->p_parent != NULL)
+        p->p_parent->p_children = p->p_sibnext;
+    if (p->p_sibnext != NULL)
+        p->p_sibnext->p_sibprev = p->p_sibprev;
+    p->p_parent = p->p_sibnext = p->p_sibprev = NULL;
+}
+
+// Frees P and its pid, P must have no children left
+static void proc_free(struct proc *p) {
+    struct proc **pp;
+
+    assert(p->p_children == NULL);
+    assert(p->p_waiting == 0);
+
+    proc_unlink(p);
+    for (pp = &proctable[PROC_HASH(p->p_pid)]; *pp != p; pp = &(*pp)->p_hashnext);
+    *pp = p->p_hashnext;
+
+    pid_set(p->p_pid, 0);
+    nprocs--;
+    if (p->p_user) nuserprocs--;
+    if (DEBUG_PID) kprintf("pid: freed %d\n", p->p_pid);
+
+    if (p->p_waitcv != NULL) cv_destroy(p->p_waitcv);
+    kfree(p);
+}
+
+static struct proc *proc_alloc(pid_t pid, struct proc *parent) {
+    struct proc *p = kmalloc(sizeof(struct proc));
+    if (p == NULL) return NULL;
+
+    p->p_pid = pid;
+    p->p_exited = 0;
+    p->p_exitcode = 0;
+    p->p_waiting = 0;
+    p->p_waitcv = NULL;
+    p->p_children = NULL;
+    p->p_sibprev = NULL;
+    p->p_parent = parent;
+    p->p_sibnext = NULL;
+    p->p_user = 0;
+    p->p_nchildren = 0;
+    p->p_maxchildren = proc_maxchildren;
+    if (parent != NULL) {
+        p->p_sibnext = parent->p_children;
+        if (parent->p_children != NULL) parent->p_children->p_sibprev = p;
+        parent->p_children = p;
+        parent->p_nchildren++;
+        if (parent->p_user) {
+            p->p_user = 1;
+            nuserprocs++;
+        }
+    }
+
+    p->p_hashnext = proctable[PROC_HASH(pid)];
+    proctable[PROC_HASH(pid)] = p;
+    nprocs++;
+    return p;
+}
+
+struct proc *proc_bootstrap() {
+    proclock = lock_create("proclock");
+    if (proclock == NULL)
+        panic("proc_bootstrap: Could not create the lock\n");
+
+    pid_set(0, 1);
+    struct proc *p = proc_alloc(0, NULL);
+    if (p == NULL)
+        panic("proc_bootstrap: Out of memory\n");
+    return p;
+}
+
+// Nonzero if PARENT may not have another child. Called with proclock
+// held, or without it as a hint
+static int proc_overlimit(struct proc *parent) {
+    if (parent == NULL || !parent->p_user)
+        return 0;
+    return nuserprocs >= proc_maxprocs ||
+            parent->p_nchildren >= parent->p_maxchildren;
+}
+
+int proc_create(struct proc *parent, struct proc **ret) {
+    pid_t pid;
+
+    lock_acquire(proclock);
+    if (proc_overlimit(parent)) {
+        lock_release(proclock);
+        if (DEBUG_PID) kprintf("pid: %d over its limit\n", parent->p_pid);
+        return EAGAIN;
+    }
+
+    int err = pid_alloc(&pid);
+    if (err) {
+        lock_release(proclock);
+        return err;
+    }
+
+    *ret = proc_alloc(pid, parent);
+    if (*ret == NULL) {
+        pid_set(pid, 0);
+        lock_release(proclock);
+        return ENOMEM;
+    }
+    lock_release(proclock);
+
+    if (DEBUG_PID) kprintf("pid: created %d\n", pid);
+    return 0;
+}
+
+void proc_exit(struct proc *p, int exitcode, int keep) {
+    struct proc *c, *next;
+
+    lock_acquire(proclock);
+
+    // Nobody is going to wait for the children now
+    for (c = p->p_children; c != NULL; c = next) {
+        next = c->p_sibnext;
+        if (c->p_exited) {
+            proc_free(c);
+        } else {
+            c->p_parent = c->p_sibnext = c->p_sibprev = NULL;
+        }
+    }
+    p->p_children = NULL;
+    p->p_nchildren = 0;
+
+    p->p_exited = 1;
+    p->p_exitcode = exitcode;
+
+    if (p->p_waiting > 0) {
+        cv_broadcast(p->p_waitcv, proclock);
+    } else if (!keep || p->p_parent == NULL) {
+        proc_free(p);
+    }
+
+    lock_release(proclock);
+}
+
+int proc_wait(struct proc *parent, pid_t pid, int *exitcode) {
+    lock_acquire(proclock);
+
+    struct proc *p = proc_lookup(pid);
+    if (p == NULL || p->p_parent != parent) {
+        lock_release(proclock);
+        return EINVAL;
+    }
+
+    while (!p->p_exited) {
+        if (p->p_waitcv == NULL) {
+            p->p_waitcv = cv_create("proc");
+            if (p->p_waitcv == NULL) {
+                lock_release(proclock);
+                return ENOMEM;
+            }
+        }
+        p->p_waiting++;
+        cv_wait(p->p_waitcv, proclock);
+        p->p_waiting--;
+    }
+
+    *exitcode = p->p_exitcode;
+    if (p->p_waiting == 0) proc_free(p);
+
+    lock_release(proclock);
+    return 0;
+}
+
+int proc_count() {
+    return nprocs;
+}
+
+int proc_admit(struct proc *parent) {
+    return proc_overlimit(parent) ? EAGAIN : 0;
+}
+
+void proc_setuser(struct proc *p) {
+    lock_acquire(proclock);
+    if (!p->p_user) {
+        p->p_user = 1;
+        nuserprocs++;
+    }
+    lock_release(proclock);
+}
+
+int proc_usercount() {
+    return nuserprocs;
+}
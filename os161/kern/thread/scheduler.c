@@ -9,8 +9,10 @@
 #include <lib.h>
 #include <scheduler.h>
 #include <thread.h>
+#include <curthread.h>
 #include <machine/spl.h>
 #include <queue.h>
+#include <vm.h>
 
 /*
  *  Scheduler data
@@ -91,7 +93,18 @@ scheduler(void)
 	assert(curspl>0);
 	
 	while (q_empty(runqueue)) {
-		cpu_idle();
+		/*
+		 * Spend idle time zeroing free frames, one per pass, and
+		 * let waiting interrupts in after each so a refill does
+		 * not hold off the clock or console. Sleep when done.
+		 */
+		if (ram_prezero()) {
+			spl0();
+			splhigh();
+		}
+		else {
+			cpu_idle();
+		}
 	}
 
 	// You can actually uncomment this to see what the scheduler's
@@ -101,7 +114,9 @@ scheduler(void)
 	// 
 	//print_run_queue();
 	
-	return q_remhead(runqueue);
+	struct thread *t = q_remhead(runqueue);
+	t->t_ticks = 0;
+	return t;
 }
 
 /* 
@@ -117,6 +132,30 @@ make_runnable(struct thread *t)
 	return q_addtail(runqueue, t);
 }
 
+/*
+ * Clock tick. Charges the tick to the current thread. When its quantum
+ * is up it goes to the back of the queue, unless nothing else is
+ * waiting, in which case it just starts a new quantum in place.
+ */
+int
+scheduler_tick(void)
+{
+	struct thread *cur = curthread;
+
+	assert(curspl>0);
+
+	/* Idle loop */
+	if (cur == NULL) {
+		return 0;
+	}
+
+	if (++cur->t_ticks < sched_quantum) {
+		return 0;
+	}
+	cur->t_ticks = 0;
+	return !q_empty(runqueue);
+}
+
 /*
  * Debugging function to dump the run queue.
  */
@@ -138,8 +177,3 @@ print_run_queue(void)
 	
 	splx(spl);
 }
-
-struct queue*
-get_run_queue(void) {
-    return runqueue;
-}
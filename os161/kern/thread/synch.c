@@ -9,6 +9,9 @@
 #include <thread.h>
 #include <curthread.h>
 #include <machine/spl.h>
+#include <kern/errno.h>
+#include <clock.h>
+#include <timer.h>
 
 ////////////////////////////////////////////////////////////
 //
@@ -79,6 +82,36 @@ P(struct semaphore *sem) {
     splx(spl);
 }
 
+/*
+ * The deadline is fixed up front, so being woken by a V that somebody
+ * else's P gets to first does not restart the wait.
+ */
+int
+P_timeout(struct semaphore *sem, u_int32_t msecs) {
+    u_int32_t deadline;
+    int spl, result = 0;
+    assert(sem != NULL);
+
+    // May not block in an interrupt handler
+    assert(in_interrupt == 0);
+
+    spl = splhigh();
+    deadline = clock_ticks + mstoticks(msecs);
+    while (sem->count == 0) {
+        if ((int32_t) (deadline - clock_ticks) <= 0) {
+            result = ETIMEDOUT;
+            break;
+        }
+        thread_sleep_timeout(sem, deadline - clock_ticks);
+    }
+    if (result == 0) {
+        assert(sem->count > 0);
+        sem->count--;
+    }
+    splx(spl);
+    return result;
+}
+
 void
 V(struct semaphore *sem) {
     int spl;
@@ -86,7 +119,8 @@ V(struct semaphore *sem) {
     spl = splhigh();
     sem->count++;
     assert(sem->count > 0);
-    thread_wakeup(sem);
+    // One unit, one waiter. The rest would only go back to sleep.
+    thread_wakeone(sem);
     splx(spl);
 }
 
@@ -111,15 +145,19 @@ lock_create(const char *name) {
 
     // add stuff here as needed
     lock->held = 0;
+    lock->holder = NULL;
     
     return lock;
 }
 
 void
 lock_destroy(struct lock *lock) {
+    int spl;
     assert(lock != NULL);
 
-    // add stuff here as needed
+    spl = splhigh();
+    assert(thread_hassleepers(lock) == 0);
+    splx(spl);
 
     kfree(lock->name);
     kfree(lock);
@@ -128,11 +166,21 @@ lock_destroy(struct lock *lock) {
 void
 lock_acquire(struct lock *lock) {
     
+    // May not block in an interrupt handler
+    assert(in_interrupt == 0);
+    
     int s = splhigh();
-    while (lock->held) {
-        thread_sleep(lock);
+    if (lock->held) {
+        // Waiters queue in FIFO order and are handed the lock directly,
+        // so by the time we run again it is already ours
+        do {
+            thread_sleep(lock);
+        } while (lock->holder != curthread);
+    }
+    else {
+        lock->held = 1;
+        lock->holder = curthread;
     }
-    lock->held = 1;
     splx(s); 
     
 }
@@ -141,19 +189,21 @@ void
 lock_release(struct lock *lock) {
     
     int s = splhigh();
-    lock->held = 0;
-    thread_wakeup(lock);
+    struct thread *next = thread_wakeone(lock);
+    if (next != NULL) {
+        lock->holder = next;    // Hand off, the lock stays held
+    }
+    else {
+        lock->held = 0;
+        lock->holder = NULL;
+    }
     splx(s);
     
 }
 
 int
 lock_do_i_hold(struct lock *lock) {
-    // Write this
-
-    (void) lock; // suppress warning until code gets written
-
-    return 1; // dummy until code gets written
+    return lock->held && lock->holder == curthread;
 }
 
 ////////////////////////////////////////////////////////////
@@ -175,45 +225,68 @@ cv_create(const char *name) {
         return NULL;
     }
 
-    // add stuff here as needed
-
     return cv;
 }
 
 void
 cv_destroy(struct cv *cv) {
+    int spl;
     assert(cv != NULL);
 
-    // add stuff here as needed
+    spl = splhigh();
+    assert(thread_hassleepers(cv) == 0);
+    splx(spl);
 
     kfree(cv->name);
     kfree(cv);
 }
 
+/*
+ * Mesa semantics: waiters sleep on the CV's wait channel in FIFO order,
+ * and a woken waiter only gets the lock back after the signaller lets
+ * go of it, so callers must re-check their condition in a loop.
+ */
 void
 cv_wait(struct cv *cv, struct lock *lock) {
+    assert(lock_do_i_hold(lock));
     
-    lock_release(lock);
+    // Releasing and sleeping at splhigh means no signal can be lost
     int s = splhigh();
+    lock_release(lock);
     thread_sleep(cv);
     splx(s); 
+    
+    lock_acquire(lock);
+}
+
+int
+cv_wait_timeout(struct cv *cv, struct lock *lock, u_int32_t msecs) {
+    int result;
+    assert(lock_do_i_hold(lock));
+
+    int s = splhigh();
+    lock_release(lock);
+    result = thread_sleep_timeout(cv, mstoticks(msecs));
+    splx(s);
+
+    lock_acquire(lock);
+    return result;
 }
 
 void
 cv_signal(struct cv *cv, struct lock *lock) {
+    assert(lock_do_i_hold(lock));
 
     int s = splhigh();
-    thread_wakeup(cv);      // not sure about this
+    thread_wakeone(cv);
     splx(s);   
-    lock_acquire(lock);
-     
 }
 
 void
 cv_broadcast(struct cv *cv, struct lock *lock) {
+    assert(lock_do_i_hold(lock));
     
     int s = splhigh();
     thread_wakeup(cv);
     splx(s); 
-    lock_acquire(lock);
 }
@@ -12,11 +12,13 @@
 #include <scheduler.h>
 #include <addrspace.h>
 #include <vnode.h>
-#include <linkedlist.h>
-#include <hashtable.h>
+#include <pid.h>
+#include <file.h>
 #include "opt-synchprobs.h"
 #include <queue.h>
 #include <synch.h>
+#include <clock.h>
+#include <timer.h>
 
 /* States a thread can be in. */
 typedef enum {
@@ -29,8 +31,23 @@ typedef enum {
 /* Global variable for the thread currently executing at any given time. */
 struct thread *curthread;
 
-/* Table of sleeping threads. */
-static struct array *sleepers;
+/*
+ * Wait channels. Sleeping threads are hashed by sleep address into
+ * buckets, each a FIFO linked through t_sleepnext. Threads on the same
+ * address stay in the order they went to sleep, so waking costs the
+ * length of one bucket instead of every sleeper in the system.
+ */
+#define WCHAN_BUCKETS 64
+
+struct wchan {
+    struct thread *wc_head;
+    struct thread *wc_tail;
+};
+
+static struct wchan wchans[WCHAN_BUCKETS];
+
+#define WCHAN_HASH(addr) \
+    (((((u_int32_t) (addr)) >> 2) ^ (((u_int32_t) (addr)) >> 10)) % WCHAN_BUCKETS)
 
 /* List of dead threads to be disposed of. */
 static struct array *zombies;
@@ -38,6 +55,68 @@ static struct array *zombies;
 /* Total number of outstanding threads. Does not count zombies[]. */
 static int numthreads;
 
+/* Context switches since boot. */
+unsigned thread_switchcount;
+
+/* Every thread that has not exited yet, for accounting. */
+static struct array *allthreads;
+
+/* Accounting left behind by threads that have exited. */
+static struct rusage exited_rusage;
+
+/*
+ * Sleep time by wait channel. Channels get an entry the first time
+ * anything sleeps on them; once the table is full the rest are lumped
+ * together in the last entry.
+ */
+#define WCHANSTATS 32
+
+static struct wchanstat {
+    const void *ws_addr;
+    unsigned ws_sleeps;
+    u_int32_t ws_ticks;
+} wchanstats[WCHANSTATS];
+
+/*
+ * Dead threads kept for reuse, stacks included, so thread_fork does not
+ * have to go back to kmalloc and the coremap every time.
+ */
+#define THREADCACHE_SIZE 16
+
+static struct thread *threadcache[THREADCACHE_SIZE];
+static int threadcache_count;
+
+int thread_cache_enabled = 1;
+unsigned thread_cache_hits, thread_cache_misses;
+
+/*
+ * Reset everything but the name and stack to the state of a brand new
+ * thread.
+ */
+static
+void
+thread_init(struct thread *thread) {
+    thread->t_sleepaddr = NULL;
+    thread->t_sleepnext = NULL;
+    thread->t_level = 0;
+    thread->t_ticks = 0;
+    thread->t_timedout = 0;
+    thread->t_woken = 0;
+    bzero(&thread->t_rusage, sizeof(struct rusage));
+    thread->t_stamp = clock_ticks;
+
+    thread->t_vmspace = NULL;
+
+    thread->t_cwd = NULL;
+    thread->t_files = NULL;
+
+    thread->pid = 0;
+    thread->t_proc = NULL;
+    thread->exitcode = 0;
+    thread->t_joinable = 0;
+    thread->t_exited = 0;
+}
+
 /*
  * Create a thread. This is used both to create the first thread's 
  * thread structure and to create subsequent threads.
@@ -55,18 +134,50 @@ thread_create(const char *name) {
         kfree(thread);
         return NULL;
     }
-    thread->t_sleepaddr = NULL;
     thread->t_stack = NULL;
+    thread_init(thread);
+    
+    return thread;
+}
 
-    thread->t_vmspace = NULL;
+/*
+ * Take a dead thread, with its stack, out of the cache and make it
+ * look new. The old name buffer is kept if the new name fits.
+ * Returns NULL if the cache is empty.
+ */
+static
+struct thread *
+thread_reuse(const char *name) {
+    struct thread *thread = NULL;
+    int spl = splhigh();
 
-    thread->t_cwd = NULL;
+    if (thread_cache_enabled && threadcache_count > 0) {
+        thread = threadcache[--threadcache_count];
+        thread_cache_hits++;
+    } else {
+        thread_cache_misses++;
+    }
+    splx(spl);
 
-    thread->parent_pid = 0;
-    thread->pid = 0;
-    thread->child_pid = NULL;
-    thread->exitcode = -1;
-    
+    if (thread == NULL) {
+        return NULL;
+    }
+
+    if (strlen(name) <= strlen(thread->t_name)) {
+        strcpy(thread->t_name, name);
+    } else {
+        char *newname = kstrdup(name);
+        if (newname == NULL) {
+            kfree(thread->t_stack);
+            kfree(thread->t_name);
+            kfree(thread);
+            return NULL;
+        }
+        kfree(thread->t_name);
+        thread->t_name = newname;
+    }
+
+    thread_init(thread);
     return thread;
 }
 
@@ -87,6 +198,18 @@ thread_destroy(struct thread *thread) {
     // These things are cleaned up in thread_exit.
     assert(thread->t_vmspace == NULL);
     assert(thread->t_cwd == NULL);
+    assert(thread->t_files == NULL);
+
+    // Keep it for the next thread_fork if there is room
+    if (thread->t_stack != NULL && thread_cache_enabled) {
+        int spl = splhigh();
+        if (threadcache_count < THREADCACHE_SIZE) {
+            threadcache[threadcache_count++] = thread;
+            splx(spl);
+            return;
+        }
+        splx(spl);
+    }
 
     if (thread->t_stack) {
         kfree(thread->t_stack);
@@ -124,7 +247,8 @@ exorcise(void) {
 static
 void
 thread_killall(void) {
-    int i, result;
+    int i;
+    struct thread *t;
 
     assert(curspl > 0);
 
@@ -133,23 +257,21 @@ thread_killall(void) {
      * wake up while we're shutting down.
      */
 
-    for (i = 0; i < array_getnum(sleepers); i++) {
-        struct thread *t = array_getguy(sleepers, i);
-        kprintf("sleep: Dropping thread %s\n", t->t_name);
+    for (i = 0; i < WCHAN_BUCKETS; i++) {
+        for (t = wchans[i].wc_head; t != NULL; t = t->t_sleepnext) {
+            kprintf("sleep: Dropping thread %s\n", t->t_name);
 
-        /*
-         * Don't do this: because these threads haven't
-         * been through thread_exit, thread_destroy will
-         * get upset. Just drop the threads on the floor,
-         * which is safer anyway during panic.
-         *
-         * array_add(zombies, t);
-         */
+            /*
+             * Don't do this: because these threads haven't
+             * been through thread_exit, thread_destroy will
+             * get upset. Just drop the threads on the floor,
+             * which is safer anyway during panic.
+             *
+             * array_add(zombies, t);
+             */
+        }
+        wchans[i].wc_head = wchans[i].wc_tail = NULL;
     }
-
-    result = array_setsize(sleepers, 0);
-    /* shrinking array: not supposed to fail */
-    assert(result == 0);
 }
 
 /*
@@ -171,15 +293,14 @@ thread_bootstrap(void) {
     struct thread *me;
 
     /* Create the data structures we need. */
-    sleepers = array_create();
-    if (sleepers == NULL) {
-        panic("Cannot create sleepers array\n");
-    }
-
     zombies = array_create();
     if (zombies == NULL) {
         panic("Cannot create zombies array\n");
     }
+    allthreads = array_create();
+    if (allthreads == NULL) {
+        panic("Cannot create allthreads array\n");
+    }
 
     /*
      * Create the thread structure for the first thread
@@ -200,17 +321,16 @@ thread_bootstrap(void) {
 
     /* Set curthread */
     curthread = me;
+    if (array_add(allthreads, me)) {
+        panic("thread_bootstrap: Out of memory\n");
+    }
 
     /* Number of threads starts at 1 */
     numthreads = 1;
     
-    /* All pids are set to empty*/
-    ht_initialize(&pidlist);
-    pidtablelock = lock_create("pidtablelock");
-    unsigned i;
-    for(i = 0; i < sizeof(exitcodes) / sizeof(int); ++i) {
-        exitcodes[i] = -1000;
-    }
+    /* The process table, we are pid 0 */
+    me->t_proc = proc_bootstrap();
+    me->pid = me->t_proc->p_pid;
     
     /* Done */
     return me;
@@ -221,10 +341,17 @@ thread_bootstrap(void) {
  */
 void
 thread_shutdown(void) {
-    array_destroy(sleepers);
-    sleepers = NULL;
+    while (threadcache_count > 0) {
+        struct thread *t = threadcache[--threadcache_count];
+        kfree(t->t_stack);
+        kfree(t->t_name);
+        kfree(t);
+    }
+
     array_destroy(zombies);
     zombies = NULL;
+    array_destroy(allthreads);
+    allthreads = NULL;
     // Don't do this - it frees our stack and we blow up
     //thread_destroy(curthread);
 }
@@ -232,31 +359,46 @@ thread_shutdown(void) {
 /*
  * Create a new thread based on an existing one.
  * The new thread has name NAME, and starts executing in function FUNC.
- * DATA1 and DATA2 are passed to FUNC.
+ * DATA1 and DATA2 are passed to FUNC. If JOINABLE is set the thread
+ * is kept after it exits until thread_join collects it.
  */
+static
 int
-thread_fork(const char *name,
+thread_fork_common(const char *name,
         void *data1, unsigned long data2,
         void (*func)(void *, unsigned long),
-        struct thread **ret) {
+        struct thread **ret, int joinable) {
     struct thread *newguy;
     int s, result;
 
-    /* Allocate a thread */
-    newguy = thread_create(name);
+    /* Recycle a dead thread and its stack, or allocate new ones */
+    newguy = thread_reuse(name);
     if (newguy == NULL) {
-        return ENOMEM;
+        newguy = thread_create(name);
+        if (newguy == NULL) {
+            return ENOMEM;
+        }
+
+        newguy->t_stack = kmalloc(STACK_SIZE);
+        if (newguy->t_stack == NULL) {
+            kfree(newguy->t_name);
+            kfree(newguy);
+            return ENOMEM;
+        }
     }
+    newguy->t_joinable = joinable;
 
-    /* Allocate a stack */
-    newguy->t_stack = kmalloc(STACK_SIZE);
-    if (newguy->t_stack == NULL) {
+    /* Give it a pid, as a child of the current thread */
+    result = proc_create(curthread->t_proc, &newguy->t_proc);
+    if (result) {
+        kfree(newguy->t_stack);
         kfree(newguy->t_name);
         kfree(newguy);
-        return ENOMEM;
+        return result;
     }
+    newguy->pid = newguy->t_proc->p_pid;
 
-    /* stick a magic number on the bottom end of the stack */
+    /* stick a magic number on the bottom end of the stack (again, if reused) */
     newguy->t_stack[0] = 0xae;
     newguy->t_stack[1] = 0x11;
     newguy->t_stack[2] = 0xda;
@@ -278,11 +420,11 @@ thread_fork(const char *name,
      * Make sure our data structures have enough space, so we won't
      * run out later at an inconvenient time.
      */
-    result = array_preallocate(sleepers, numthreads + 1);
+    result = array_preallocate(zombies, numthreads + 1);
     if (result) {
         goto fail;
     }
-    result = array_preallocate(zombies, numthreads + 1);
+    result = array_preallocate(allthreads, numthreads + 1);
     if (result) {
         goto fail;
     }
@@ -299,6 +441,10 @@ thread_fork(const char *name,
         goto fail;
     }
 
+    /* Preallocated above, cannot fail */
+    result = array_add(allthreads, newguy);
+    assert(result == 0);
+
     /*
      * Increment the thread counter. This must be done atomically
      * with the preallocate calls; otherwise the count can be
@@ -307,17 +453,6 @@ thread_fork(const char *name,
      */
     numthreads++;
     
-    /*
-     * Find the next valid PID for the thread
-     */
-    
-    lock_acquire(pidtablelock);
-    newguy->parent_pid = curthread->pid;                // Add parent to this
-    newguy->pid = ht_setempty(&pidlist);                // Find a new PID
-    
-    push_end(&curthread->child_pid, newguy->pid);     // Add this as child of parent
-    lock_release(pidtablelock);
-    
     /* Done with stuff that needs to be atomic */
     splx(s);
 
@@ -335,6 +470,7 @@ thread_fork(const char *name,
 
 fail:
     splx(s);
+    proc_exit(newguy->t_proc, 0, 0);
     if (newguy->t_cwd != NULL) {
         VOP_DECREF(newguy->t_cwd);
     }
@@ -345,35 +481,44 @@ fail:
     return result;
 }
 
-void
-thread_join(const char *name) {
-    
-    while(1) {
-        
-        thread_yield();
-        
-        int s = splhigh();
-        
-        int stillwaiting = 0;
-        
-        int i;
-        struct queue* runqueue = get_run_queue();
-	i = q_getstart(runqueue);
-        
-        // if you find the thread in the runqueue it means it hasn't exited
-        while (i!=q_getend(runqueue)) {
-            struct thread *t = q_getguy(runqueue, i);
-            if (strcmp(t->t_name, name) == 0) {     
-                stillwaiting = 1;       
-            }
-            i=(i+1)%q_getsize(runqueue);
-	}
-        
-        splx(s);
-        
-        if (!stillwaiting)        
-            return;
-    }    
+int
+thread_fork(const char *name,
+        void *data1, unsigned long data2,
+        void (*func)(void *, unsigned long),
+        struct thread **ret) {
+    return thread_fork_common(name, data1, data2, func, ret, 0);
+}
+
+int
+thread_fork_joinable(const char *name,
+        void *data1, unsigned long data2,
+        void (*func)(void *, unsigned long),
+        struct thread **ret) {
+    assert(ret != NULL);
+    return thread_fork_common(name, data1, data2, func, ret, 1);
+}
+
+/*
+ * Wait for joinable thread T to exit, free it, and return its exit
+ * value. The exiting thread wakes us from thread_exit; by the time we
+ * run again it has switched away for good, so it is safe to destroy.
+ */
+int
+thread_join(struct thread *t) {
+    int spl, exitval;
+
+    assert(t->t_joinable);
+    assert(t != curthread);
+
+    spl = splhigh();
+    while (!t->t_exited) {
+        thread_sleep(t);
+    }
+    splx(spl);
+
+    exitval = t->exitcode;
+    thread_destroy(t);
+    return exitval;
 }
 
 /*
@@ -421,14 +566,20 @@ mi_switch(threadstate_t nextstate) {
     if (nextstate == S_READY) {
         result = make_runnable(cur);
     } else if (nextstate == S_SLEEP) {
-        /*
-         * Because we preallocate sleepers[] during thread_fork,
-         * this should never fail.
-         */
-        result = array_add(sleepers, cur);
+        /* Goes on the tail of its wait channel, this cannot fail */
+        struct wchan *wc = &wchans[WCHAN_HASH(cur->t_sleepaddr)];
+        cur->t_sleepnext = NULL;
+        if (wc->wc_tail == NULL) {
+            wc->wc_head = cur;
+        } else {
+            wc->wc_tail->t_sleepnext = cur;
+        }
+        wc->wc_tail = cur;
+        result = 0;
     } else {
         assert(nextstate == S_ZOMB);
-        result = array_add(zombies, cur);
+        /* Joinable threads are destroyed by thread_join instead */
+        result = cur->t_joinable ? 0 : array_add(zombies, cur);
     }
     assert(result == 0);
 
@@ -441,6 +592,24 @@ mi_switch(threadstate_t nextstate) {
     /* update curthread */
     curthread = next;
 
+    /*
+     * Nothing else was runnable and we got ourselves back. There is no
+     * context to switch and the address space is still loaded.
+     */
+    if (next == cur) {
+        return;
+    }
+    thread_switchcount++;
+
+    /* Accounting: why cur stopped, and how long next waited to run */
+    if (nextstate == S_SLEEP) {
+        cur->t_rusage.ru_nvcsw++;
+    } else if (nextstate == S_READY) {
+        cur->t_rusage.ru_nivcsw++;
+    }
+    cur->t_stamp = clock_ticks;
+    next->t_rusage.ru_waittime += clock_ticks - next->t_stamp;
+
     /* 
      * Call the machine-dependent code that actually does the
      * context switch.
@@ -462,6 +631,146 @@ mi_switch(threadstate_t nextstate) {
     }
 }
 
+/*
+ * Take T off the list of live threads and keep its accounting in the
+ * system totals.
+ */
+static
+void
+thread_retire(struct thread *t) {
+    struct rusage *ru = &exited_rusage;
+    int i;
+
+    assert(curspl > 0);
+
+    ru->ru_utime += t->t_rusage.ru_utime;
+    ru->ru_stime += t->t_rusage.ru_stime;
+    ru->ru_waittime += t->t_rusage.ru_waittime;
+    ru->ru_sleeptime += t->t_rusage.ru_sleeptime;
+    ru->ru_nvcsw += t->t_rusage.ru_nvcsw;
+    ru->ru_nivcsw += t->t_rusage.ru_nivcsw;
+
+    for (i = 0; i < array_getnum(allthreads); i++) {
+        if (array_getguy(allthreads, i) == t) {
+            array_remove(allthreads, i);
+            return;
+        }
+    }
+    panic("thread_retire: %s not found\n", t->t_name);
+}
+
+/*
+ * Copy T's accounting into USAGE, including the time it has spent on
+ * the run queue or asleep so far without having been charged for it.
+ */
+static
+void
+thread_snapshot(struct thread *t, struct rusage *usage) {
+    const char *name = t->t_name;
+    unsigned i;
+
+    *usage = t->t_rusage;
+    if (t != curthread) {
+        if (t->t_sleepaddr != NULL) {
+            usage->ru_sleeptime += clock_ticks - t->t_stamp;
+        } else {
+            usage->ru_waittime += clock_ticks - t->t_stamp;
+        }
+    }
+    usage->ru_wchan = (u_int32_t) t->t_sleepaddr;
+    usage->ru_hz = HZ;
+
+    for (i = 0; i < sizeof(usage->ru_name) - 1 && name[i] != 0; i++) {
+        usage->ru_name[i] = name[i];
+    }
+    usage->ru_name[i] = 0;
+}
+
+int
+thread_getrusage(int pid, struct rusage *usage, pid_t *nextpid) {
+    struct rusage ru;
+    int i, result = ESRCH;
+    int spl = splhigh();
+
+    // The boot thread, pid 0, is never anybody's next
+    *nextpid = 0;
+    for (i = 0; i < array_getnum(allthreads); i++) {
+        struct thread *t = array_getguy(allthreads, i);
+        if ((int) t->pid > pid && t->pid != 0 &&
+                (*nextpid == 0 || (int) t->pid < *nextpid)) {
+            *nextpid = t->pid;
+        }
+    }
+
+    if (pid == RUSAGE_SYSTEM) {
+        *usage = exited_rusage;
+        for (i = 0; i < array_getnum(allthreads); i++) {
+            thread_snapshot(array_getguy(allthreads, i), &ru);
+            usage->ru_utime += ru.ru_utime;
+            usage->ru_stime += ru.ru_stime;
+            usage->ru_waittime += ru.ru_waittime;
+            usage->ru_sleeptime += ru.ru_sleeptime;
+            usage->ru_nvcsw += ru.ru_nvcsw;
+            usage->ru_nivcsw += ru.ru_nivcsw;
+        }
+        usage->ru_idletime = idle_ticks;
+        usage->ru_wchan = 0;
+        usage->ru_hz = HZ;
+        strcpy(usage->ru_name, "system");
+        result = 0;
+    } else {
+        for (i = 0; i < array_getnum(allthreads); i++) {
+            struct thread *t = array_getguy(allthreads, i);
+            if (t->pid == (unsigned) pid) {
+                thread_snapshot(t, usage);
+                result = 0;
+                break;
+            }
+        }
+    }
+
+    splx(spl);
+    return result;
+}
+
+void
+thread_printstats(void) {
+    struct rusage ru;
+    int i;
+    int spl = splhigh();
+
+    kprintf("  PID NAME              USER   SYS  WAIT SLEEP  VCSW IVCSW WCHAN\n");
+    for (i = 0; i < array_getnum(allthreads); i++) {
+        struct thread *t = array_getguy(allthreads, i);
+        thread_snapshot(t, &ru);
+        kprintf("%5d %-16s %5u %5u %5u %5u %5u %5u %p\n", t->pid, t->t_name,
+                ru.ru_utime, ru.ru_stime, ru.ru_waittime, ru.ru_sleeptime,
+                ru.ru_nvcsw, ru.ru_nivcsw, t->t_sleepaddr);
+    }
+    kprintf("%u ticks since boot, %u idle, %u context switches\n",
+            clock_ticks, idle_ticks, thread_switchcount);
+    kprintf("Thread cache: %d/%d cached, %u hits, %u misses\n",
+            threadcache_count, THREADCACHE_SIZE, thread_cache_hits,
+            thread_cache_misses);
+
+    kprintf("\nSleep time by wait channel:\n");
+    kprintf("  WCHAN      SLEEPS  TICKS\n");
+    for (i = 0; i < WCHANSTATS; i++) {
+        if (wchanstats[i].ws_sleeps == 0) {
+            continue;
+        }
+        if (wchanstats[i].ws_addr != NULL) {
+            kprintf("  %p %6u %6u\n", wchanstats[i].ws_addr,
+                    wchanstats[i].ws_sleeps, wchanstats[i].ws_ticks);
+        } else {
+            kprintf("  (others)   %6u %6u\n",
+                    wchanstats[i].ws_sleeps, wchanstats[i].ws_ticks);
+        }
+    }
+
+    splx(spl);
+}
+
 /*
  * Cause the current thread to exit.
  *
@@ -485,6 +794,22 @@ thread_exit(void) {
         assert(curthread->t_stack[3] == (char) 0x33);
     }
 
+    // Closing files can sleep, so do it before going to splhigh
+    if (curthread->t_files) {
+        struct filetable *ft = curthread->t_files;
+        curthread->t_files = NULL;
+        filetable_destroy(ft);
+    }
+
+    /*
+     * User processes leave their exit status for waitpid in sys_exit.
+     * Nobody waits for other threads, so their pid goes straight back.
+     */
+    if (curthread->t_proc != NULL) {
+        proc_exit(curthread->t_proc, curthread->exitcode, 0);
+        curthread->t_proc = NULL;
+    }
+
     splhigh();
 
     if (curthread->t_vmspace) {
@@ -502,6 +827,13 @@ thread_exit(void) {
         curthread->t_cwd = NULL;
     }
         
+    thread_retire(curthread);
+
+    if (curthread->t_joinable) {
+        curthread->t_exited = 1;
+        thread_wakeup(curthread);
+    }
+
     assert(numthreads > 0);
     numthreads--;
     mi_switch(S_ZOMB);
@@ -509,6 +841,15 @@ thread_exit(void) {
     panic("Thread came back from the dead!\n");
 }
 
+/*
+ * Exit, handing EXITVAL to whoever joins this thread.
+ */
+void
+thread_exitval(int exitval) {
+    curthread->exitcode = exitval;
+    thread_exit();
+}
+
 /*
  * Yield the cpu to another process, but stay runnable.
  */
@@ -516,8 +857,8 @@ void
 thread_yield(void) {
     int spl = splhigh();
 
-    /* Check sleepers just in case we get here after shutdown */
-    assert(sleepers != NULL);
+    /* Check zombies just in case we get here after shutdown */
+    assert(zombies != NULL);
 
     mi_switch(S_READY);
     splx(spl);
@@ -545,36 +886,149 @@ thread_sleep(const void *addr) {
 }
 
 /*
- * Wake up one or more threads who are sleeping on "sleep address"
- * ADDR.
+ * Charge the time T spent asleep on ADDR, to T and to the channel.
  */
+static
 void
-thread_wakeup(const void *addr) {
-    int i, result;
+wchan_account(const void *addr, struct thread *t) {
+    u_int32_t ticks = clock_ticks - t->t_stamp;
+    int i;
+
+    t->t_rusage.ru_sleeptime += ticks;
+    t->t_stamp = clock_ticks;
+
+    for (i = 0; i < WCHANSTATS - 1; i++) {
+        if (wchanstats[i].ws_addr == NULL) {
+            wchanstats[i].ws_addr = addr;
+        }
+        if (wchanstats[i].ws_addr == addr) {
+            break;
+        }
+    }
+    wchanstats[i].ws_sleeps++;
+    wchanstats[i].ws_ticks += ticks;
+}
+
+/*
+ * Take T off wait channel WC, where PREV is the thread ahead of it or
+ * NULL, charge it the time asleep and make it runnable.
+ */
+static
+void
+wchan_unsleep(struct wchan *wc, struct thread *prev, struct thread *t) {
+    struct thread *next = t->t_sleepnext;
+    int result;
+
+    if (prev == NULL) {
+        wc->wc_head = next;
+    } else {
+        prev->t_sleepnext = next;
+    }
+    if (wc->wc_tail == t) {
+        wc->wc_tail = prev;
+    }
+    t->t_sleepnext = NULL;
+    wchan_account(t->t_sleepaddr, t);
+
+    // Asleep no longer; from here it is waiting for the processor
+    t->t_sleepaddr = NULL;
+
+    /*
+     * Because we preallocate during thread_fork,
+     * this should never fail.
+     */
+    t->t_woken = 1;
+    result = make_runnable(t);
+    t->t_woken = 0;
+    assert(result == 0);
+}
+
+/*
+ * Wake up threads sleeping on "sleep address" ADDR, oldest first. At
+ * most MAX threads are woken, or all of them if MAX is 0. Returns the
+ * last thread woken.
+ */
+static
+struct thread *
+wchan_wake(const void *addr, int max) {
+    struct wchan *wc = &wchans[WCHAN_HASH(addr)];
+    struct thread *t, *prev = NULL, *next, *last = NULL;
+    int woken = 0;
 
     // meant to be called with interrupts off
     assert(curspl > 0);
 
-    // This is inefficient. Feel free to improve it.
+    for (t = wc->wc_head; t != NULL; t = next) {
+        next = t->t_sleepnext;
+        if (t->t_sleepaddr != addr) {
+            prev = t;
+            continue;
+        }
 
-    for (i = 0; i < array_getnum(sleepers); i++) {
-        struct thread *t = array_getguy(sleepers, i);
-        if (t->t_sleepaddr == addr) {
+        wchan_unsleep(wc, prev, t);
 
-            // Remove from list
-            array_remove(sleepers, i);
+        last = t;
+        if (++woken == max) {
+            break;
+        }
+    }
+    return last;
+}
 
-            // must look at the same sleepers[i] again
-            i--;
+/*
+ * Timer for thread_sleep_timeout. Wakes T if it is still on its wait
+ * channel; if it was woken first there is nothing to do.
+ */
+static
+void
+sleep_timeout(void *data) {
+    struct thread *t = data, *cur, *prev = NULL;
+    struct wchan *wc = &wchans[WCHAN_HASH(t->t_sleepaddr)];
 
-            /*
-             * Because we preallocate during thread_fork,
-             * this should never fail.
-             */
-            result = make_runnable(t);
-            assert(result == 0);
-        }
+    for (cur = wc->wc_head; cur != NULL && cur != t; cur = cur->t_sleepnext) {
+        prev = cur;
+    }
+    if (cur == NULL) {
+        return;
     }
+    t->t_timedout = 1;
+    wchan_unsleep(wc, prev, t);
+}
+
+/*
+ * Like thread_sleep, but give up after TICKS clock ticks. The timer
+ * lives on our stack; it is stopped before we return, so it cannot go
+ * off once the frame is gone.
+ */
+int
+thread_sleep_timeout(const void *addr, u_int32_t ticks) {
+    struct timer tm;
+
+    assert(curspl > 0);
+
+    curthread->t_timedout = 0;
+    timer_init(&tm, sleep_timeout, curthread);
+    timer_start(&tm, ticks);
+    thread_sleep(addr);
+    timer_stop(&tm);
+
+    return curthread->t_timedout ? ETIMEDOUT : 0;
+}
+
+/*
+ * Wake up all threads who are sleeping on "sleep address" ADDR.
+ */
+void
+thread_wakeup(const void *addr) {
+    wchan_wake(addr, 0);
+}
+
+/*
+ * Wake up the thread that has slept longest on "sleep address" ADDR.
+ */
+struct thread *
+thread_wakeone(const void *addr) {
+    return wchan_wake(addr, 1);
 }
 
 /*
@@ -583,13 +1037,12 @@ thread_wakeup(const void *addr) {
  */
 int
 thread_hassleepers(const void *addr) {
-    int i;
+    struct thread *t;
 
     // meant to be called with interrupts off
     assert(curspl > 0);
 
-    for (i = 0; i < array_getnum(sleepers); i++) {
-        struct thread *t = array_getguy(sleepers, i);
+    for (t = wchans[WCHAN_HASH(addr)].wc_head; t != NULL; t = t->t_sleepnext) {
         if (t->t_sleepaddr == addr) {
             return 1;
         }
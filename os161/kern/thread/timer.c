@@ -0,0 +1,200 @@
+/*
+ * Hierarchical timer wheel, see timer.h.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <thread.h>
+#include <clock.h>
+#include <timer.h>
+
+#define TVR_BITS	8			/* first level */
+#define TVN_BITS	6			/* each level above */
+#define TVN_LEVELS	3
+#define TVR_MASK	((1 << TVR_BITS) - 1)
+#define TVN_MASK	((1 << TVN_BITS) - 1)
+
+/* Bits of the expiry time that select a slot at level N above the first */
+#define TVN_SHIFT(n)	(TVR_BITS + (n) * TVN_BITS)
+
+static struct timer *tv1[1 << TVR_BITS];
+static struct timer *tvn[TVN_LEVELS][1 << TVN_BITS];
+
+/* Next tick the wheel has to process */
+static u_int32_t timer_clock;
+
+static
+void
+timer_link(struct timer **slot, struct timer *tm)
+{
+	tm->tm_next = *slot;
+	if (tm->tm_next != NULL) {
+		tm->tm_next->tm_pprev = &tm->tm_next;
+	}
+	tm->tm_pprev = slot;
+	*slot = tm;
+}
+
+static
+void
+timer_unlink(struct timer *tm)
+{
+	*tm->tm_pprev = tm->tm_next;
+	if (tm->tm_next != NULL) {
+		tm->tm_next->tm_pprev = tm->tm_pprev;
+	}
+	tm->tm_next = NULL;
+	tm->tm_pprev = NULL;
+}
+
+/*
+ * Put TM in the slot for its expiry time: the first level if it is due
+ * within a turn of it, otherwise the lowest level whose turn covers it.
+ * Anything already due goes off on the next tick processed.
+ */
+static
+void
+timer_place(struct timer *tm)
+{
+	u_int32_t expires = tm->tm_expires;
+	int32_t delta = expires - timer_clock;
+	int n;
+
+	if (delta < 0) {
+		timer_link(&tv1[timer_clock & TVR_MASK], tm);
+		return;
+	}
+	if (delta < (1 << TVR_BITS)) {
+		timer_link(&tv1[expires & TVR_MASK], tm);
+		return;
+	}
+	for (n = 0; n < TVN_LEVELS; n++) {
+		if (delta < (1 << TVN_SHIFT(n + 1))) {
+			timer_link(&tvn[n][(expires >> TVN_SHIFT(n)) & TVN_MASK],
+				   tm);
+			return;
+		}
+	}
+	panic("timer: %u ticks is beyond the wheel\n", delta);
+}
+
+/*
+ * Move every timer in slot INDEX of level N down to where it belongs
+ * now. Returns INDEX, which is 0 when this level has wrapped too.
+ */
+static
+int
+cascade(int n, int index)
+{
+	struct timer *tm, *next;
+
+	tm = tvn[n][index];
+	tvn[n][index] = NULL;
+	for (; tm != NULL; tm = next) {
+		next = tm->tm_next;
+		timer_place(tm);
+	}
+	return index;
+}
+
+void
+timer_init(struct timer *tm, void (*func)(void *), void *data)
+{
+	tm->tm_next = NULL;
+	tm->tm_pprev = NULL;
+	tm->tm_expires = 0;
+	tm->tm_func = func;
+	tm->tm_data = data;
+}
+
+void
+timer_start(struct timer *tm, u_int32_t ticks)
+{
+	assert(curspl>0);
+
+	if (tm->tm_pprev != NULL) {
+		timer_unlink(tm);
+	}
+	if (ticks > TIMER_MAXTICKS) {
+		ticks = TIMER_MAXTICKS;
+	}
+	tm->tm_expires = clock_ticks + ticks;
+	timer_place(tm);
+}
+
+int
+timer_stop(struct timer *tm)
+{
+	assert(curspl>0);
+
+	if (tm->tm_pprev == NULL) {
+		return 0;
+	}
+	timer_unlink(tm);
+	return 1;
+}
+
+/*
+ * Called from hardclock after clock_ticks is advanced. Processes every
+ * tick up to and including the current one. timer_clock moves on
+ * before a slot's timers are run, so a timer started from a timer
+ * function cannot land in the slot being emptied.
+ */
+void
+timer_tick(void)
+{
+	struct timer *due, *tm;
+	int index, n;
+
+	assert(curspl>0);
+
+	while ((int32_t) (clock_ticks - timer_clock) >= 0) {
+		index = timer_clock & TVR_MASK;
+		if (index == 0) {
+			for (n = 0; n < TVN_LEVELS; n++) {
+				if (cascade(n, (timer_clock >> TVN_SHIFT(n))
+					    & TVN_MASK) != 0) {
+					break;
+				}
+			}
+		}
+
+		due = tv1[index];
+		tv1[index] = NULL;
+		if (due != NULL) {
+			due->tm_pprev = &due;
+		}
+		timer_clock++;
+
+		/* A timer function may stop others still on the list */
+		while ((tm = due) != NULL) {
+			timer_unlink(tm);
+			tm->tm_func(tm->tm_data);
+		}
+	}
+}
+
+/*
+ * Nothing ever wakes the channel, so only the timer ends each sleep.
+ * Loops in case the wheel cut the delay short.
+ */
+void
+timer_sleep(u_int32_t ticks)
+{
+	u_int32_t deadline;
+	int spl;
+
+	spl = splhigh();
+	deadline = clock_ticks + ticks;
+	while ((int32_t) (deadline - clock_ticks) > 0) {
+		thread_sleep_timeout(&deadline, deadline - clock_ticks);
+	}
+	splx(spl);
+}
+
+u_int32_t
+mstoticks(u_int32_t msecs)
+{
+	return msecs / 1000 * HZ + ((msecs % 1000) * HZ + 999) / 1000;
+}
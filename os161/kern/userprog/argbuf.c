@@ -0,0 +1,152 @@
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/limits.h>
+#include <lib.h>
+#include <vm.h>
+#include <argbuf.h>
+
+#define ARGBUF_MIN      512     // First allocation, doubled as needed
+#define ARGV_CHUNK      16      // User argv pointers copied in at once
+
+// The offsets at the end of the buffer, argument i is at [-(i+1)]
+#define AB_OFFSETS(ab)  ((u_int32_t *) ((ab)->ab_buf + (ab)->ab_size))
+
+// Room left for the next string. Its offset, the argv array's NULL
+// and a word for aligning the strings are kept back, copyout needs them.
+static size_t ab_room(struct argbuf *ab) {
+    size_t used = ab->ab_len + (ab->ab_argc + 3) * sizeof(u_int32_t);
+    return used < ab->ab_size ? ab->ab_size - used : 0;
+}
+
+static int ab_grow(struct argbuf *ab) {
+    size_t newsize = ab->ab_size ? ab->ab_size * 2 : ARGBUF_MIN;
+    size_t offbytes = ab->ab_argc * sizeof(u_int32_t);
+    char *newbuf;
+
+    if (ab->ab_size >= ARG_MAX) return E2BIG;
+    if (newsize > ARG_MAX) newsize = ARG_MAX;
+
+    newbuf = kmalloc(newsize);
+    if (newbuf == NULL) return ENOMEM;
+
+    if (ab->ab_buf != NULL) {
+        memcpy(newbuf, ab->ab_buf, ab->ab_len);
+        memcpy(newbuf + newsize - offbytes,
+                ab->ab_buf + ab->ab_size - offbytes, offbytes);
+        kfree(ab->ab_buf);
+    }
+    ab->ab_buf = newbuf;
+    ab->ab_size = newsize;
+    return 0;
+}
+
+// Appends one string, from user space if USER is set
+static int ab_append(struct argbuf *ab, const char *src, int user) {
+    size_t got;
+    int result;
+
+    while (1) {
+        size_t room = ab_room(ab);
+        if (room == 0) {
+            result = ENAMETOOLONG;
+        } else if (user) {
+            result = copyinstr((const_userptr_t) src, ab->ab_buf + ab->ab_len,
+                    room, &got);
+        } else {
+            result = copystr(src, ab->ab_buf + ab->ab_len, room, &got);
+        }
+        if (result != ENAMETOOLONG) break;
+
+        // Does not fit, make room and copy this string again
+        result = ab_grow(ab);
+        if (result) return result;
+    }
+    if (result) return result;
+
+    ab->ab_argc++;
+    AB_OFFSETS(ab)[-ab->ab_argc] = ab->ab_len;
+    ab->ab_len += got;
+    return 0;
+}
+
+void argbuf_init(struct argbuf *ab) {
+    ab->ab_buf = NULL;
+    ab->ab_size = 0;
+    ab->ab_len = 0;
+    ab->ab_argc = 0;
+}
+
+void argbuf_cleanup(struct argbuf *ab) {
+    if (ab->ab_buf != NULL) kfree(ab->ab_buf);
+    argbuf_init(ab);
+}
+
+int argbuf_add(struct argbuf *ab, const char *arg) {
+    return ab_append(ab, arg, 0);
+}
+
+int argbuf_copyin(struct argbuf *ab, const_userptr_t uargv) {
+    userptr_t chunk[ARGV_CHUNK];
+    vaddr_t uaddr = (vaddr_t) uargv;
+    int i, n, result;
+
+    while (1) {
+        // Never read past the page the next pointer is on, the array
+        // may end right before an unmapped one
+        n = (PAGE_SIZE - uaddr % PAGE_SIZE) / sizeof(userptr_t);
+        if (n > ARGV_CHUNK) n = ARGV_CHUNK;
+
+        result = copyin((const_userptr_t) uaddr, chunk, n * sizeof(userptr_t));
+        if (result) return result;
+
+        for (i = 0; i < n; i++) {
+            if (chunk[i] == NULL) return 0;
+            result = ab_append(ab, (const char *) chunk[i], 1);
+            if (result) return result;
+        }
+        uaddr += n * sizeof(userptr_t);
+    }
+}
+
+int argbuf_copyout(struct argbuf *ab, vaddr_t *stackptr, userptr_t *uargv) {
+    size_t strbytes, total;
+    u_int32_t *argv, tmp;
+    vaddr_t base;
+    int i, result;
+
+    // An empty buffer still needs the NULL that ends argv
+    if (ab->ab_buf == NULL) {
+        result = ab_grow(ab);
+        if (result) return result;
+    }
+
+    // Strings first, then argv; base is where the block starts
+    strbytes = (ab->ab_len + 3) & ~3;
+    total = strbytes + (ab->ab_argc + 1) * sizeof(u_int32_t);
+    assert(total <= ab->ab_size);
+    base = (*stackptr - total) & ~7;
+
+    // Move the offsets down next to the strings and put them in order
+    bzero(ab->ab_buf + ab->ab_len, strbytes - ab->ab_len);
+    argv = (u_int32_t *) (ab->ab_buf + strbytes);
+    memmove(argv, AB_OFFSETS(ab) - ab->ab_argc,
+            ab->ab_argc * sizeof(u_int32_t));
+    for (i = 0; i < ab->ab_argc / 2; i++) {
+        tmp = argv[i];
+        argv[i] = argv[ab->ab_argc - 1 - i];
+        argv[ab->ab_argc - 1 - i] = tmp;
+    }
+
+    // Then turn them into user addresses
+    for (i = 0; i < ab->ab_argc; i++) {
+        argv[i] += base;
+    }
+    argv[ab->ab_argc] = 0;
+
+    result = copyout(ab->ab_buf, (userptr_t) base, total);
+    if (result) return result;
+
+    *stackptr = base;
+    *uargv = (userptr_t) (base + strbytes);
+    return 0;
+}
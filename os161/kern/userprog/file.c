@@ -0,0 +1,170 @@
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/unistd.h>
+#include <lib.h>
+#include <synch.h>
+#include <vfs.h>
+#include <file.h>
+
+#define DEBUG_FILE 0
+
+////////////////////////////////////////
+//
+// Open files
+
+static int of_create(struct vnode *vn, int flags, struct openfile **ret) {
+    struct openfile *of = kmalloc(sizeof(struct openfile));
+    if (of == NULL) return ENOMEM;
+
+    of->of_lock = lock_create("openfile");
+    if (of->of_lock == NULL) {
+        kfree(of);
+        return ENOMEM;
+    }
+    of->of_vnode = vn;
+    of->of_offset = 0;
+    of->of_flags = flags & (O_ACCMODE | O_APPEND);
+    of->of_refcount = 1;
+
+    *ret = of;
+    return 0;
+}
+
+static void of_incref(struct openfile *of) {
+    lock_acquire(of->of_lock);
+    of->of_refcount++;
+    lock_release(of->of_lock);
+}
+
+// Drops a reference, the last one closes the vnode
+static void of_decref(struct openfile *of) {
+    lock_acquire(of->of_lock);
+    assert(of->of_refcount > 0);
+    int last = --of->of_refcount == 0;
+    lock_release(of->of_lock);
+
+    if (!last) return;
+
+    vfs_close(of->of_vnode);
+    lock_destroy(of->of_lock);
+    kfree(of);
+}
+
+////////////////////////////////////////
+//
+// Tables
+
+int filetable_create(struct filetable **ret) {
+    struct filetable *ft = kmalloc(sizeof(struct filetable));
+    if (ft == NULL) return ENOMEM;
+
+    bzero(ft->ft_files, sizeof(ft->ft_files));
+    *ret = ft;
+    return 0;
+}
+
+int filetable_stdio(struct filetable *ft) {
+    static const int modes[3] = { O_RDONLY, O_WRONLY, O_WRONLY };
+    char path[5];
+    int fd, newfd, result;
+
+    for (fd = 0; fd < 3; fd++) {
+        assert(ft->ft_files[fd] == NULL);
+
+        // vfs_open scribbles on the path
+        strcpy(path, "con:");
+        result = file_open(ft, path, modes[fd], &newfd);
+        if (result) return result;
+        assert(newfd == fd);
+    }
+    return 0;
+}
+
+int filetable_copy(struct filetable *ft, struct filetable **ret) {
+    int fd;
+
+    int result = filetable_create(ret);
+    if (result) return result;
+
+    for (fd = 0; fd < OPEN_MAX; fd++) {
+        if (ft->ft_files[fd] != NULL) {
+            of_incref(ft->ft_files[fd]);
+            (*ret)->ft_files[fd] = ft->ft_files[fd];
+        }
+    }
+    return 0;
+}
+
+void filetable_destroy(struct filetable *ft) {
+    int fd;
+
+    for (fd = 0; fd < OPEN_MAX; fd++) {
+        if (ft->ft_files[fd] != NULL) {
+            of_decref(ft->ft_files[fd]);
+            ft->ft_files[fd] = NULL;
+        }
+    }
+    kfree(ft);
+}
+
+////////////////////////////////////////
+//
+// Descriptors
+
+int file_open(struct filetable *ft, char *path, int flags, int *fd) {
+    struct vnode *vn;
+    struct openfile *of;
+    int i;
+
+    if ((flags & O_ACCMODE) == O_ACCMODE) return EINVAL;
+
+    for (i = 0; i < OPEN_MAX && ft->ft_files[i] != NULL; i++);
+    if (i == OPEN_MAX) return EMFILE;
+
+    int result = vfs_open(path, flags, &vn);
+    if (result) return result;
+
+    result = of_create(vn, flags, &of);
+    if (result) {
+        vfs_close(vn);
+        return result;
+    }
+
+    ft->ft_files[i] = of;
+    *fd = i;
+    if (DEBUG_FILE) kprintf("file: opened fd %d\n", i);
+    return 0;
+}
+
+int file_get(struct filetable *ft, int fd, struct openfile **ret) {
+    if (ft == NULL || fd < 0 || fd >= OPEN_MAX || ft->ft_files[fd] == NULL)
+        return EBADF;
+    *ret = ft->ft_files[fd];
+    return 0;
+}
+
+int file_close(struct filetable *ft, int fd) {
+    struct openfile *of;
+
+    int result = file_get(ft, fd, &of);
+    if (result) return result;
+
+    ft->ft_files[fd] = NULL;
+    of_decref(of);
+    if (DEBUG_FILE) kprintf("file: closed fd %d\n", fd);
+    return 0;
+}
+
+int file_dup2(struct filetable *ft, int oldfd, int newfd) {
+    struct openfile *of;
+
+    int result = file_get(ft, oldfd, &of);
+    if (result) return result;
+    if (newfd < 0 || newfd >= OPEN_MAX) return EBADF;
+    if (oldfd == newfd) return 0;
+
+    if (ft->ft_files[newfd] != NULL) file_close(ft, newfd);
+    of_incref(of);
+    ft->ft_files[newfd] = of;
+    return 0;
+}
@@ -57,6 +57,8 @@ load_segment(struct vnode *v, off_t offset, vaddr_t vaddr,
 
     u.uio_iovec.iov_ubase = (userptr_t) vaddr;
     u.uio_iovec.iov_len = memsize; // length of the memory space
+    u.uio_iov = &u.uio_iovec;
+    u.uio_iovcnt = 1;
     u.uio_resid = filesize; // amount to actually read
     u.uio_offset = offset;
     u.uio_segflg = is_executable ? UIO_USERISPACE : UIO_USERSPACE;
@@ -190,6 +192,12 @@ load_elf(struct vnode *v, vaddr_t *entrypoint) {
         if (result) {
             return result;
         }
+        
+        // Pages past the end of the file data are never read from the file
+        if (ph.p_memsz > ph.p_filesz) {
+            as_define_bss(curthread->t_vmspace, ph.p_vaddr + ph.p_filesz,
+                    ph.p_memsz - ph.p_filesz);
+        }
     }
 
     result = as_prepare_load(curthread->t_vmspace);
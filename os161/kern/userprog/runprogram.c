@@ -15,6 +15,9 @@
 #include <vfs.h>
 #include <test.h>
 #include <coremap.h>
+#include <pid.h>
+#include <file.h>
+#include <argbuf.h>
 
 /*
  * Load program "progname" and start running it in usermode.
@@ -28,7 +31,9 @@ runprogram(char *progname, int argc, char** argv) {
 
     struct vnode *v;
     vaddr_t entrypoint, stackptr;
-    int result;
+    struct argbuf args;
+    userptr_t uargv;
+    int i, result;
 
     /* Open the file. */
     result = vfs_open(progname, O_RDONLY, &v);
@@ -49,6 +54,24 @@ runprogram(char *progname, int argc, char** argv) {
     /* Activate it. */
     as_activate(curthread->t_vmspace);
 
+    /* From here on the process and its children count as user processes. */
+    proc_setuser(curthread->t_proc);
+
+    /* Standard input, output and error go to the console. */
+    assert(curthread->t_files == NULL);
+    result = filetable_create(&curthread->t_files);
+    if (result) {
+        /* thread_exit destroys curthread->t_vmspace */
+        vfs_close(v);
+        return result;
+    }
+    result = filetable_stdio(curthread->t_files);
+    if (result) {
+        /* thread_exit closes curthread->t_files */
+        vfs_close(v);
+        return result;
+    }
+
     /* Load the executable. */
     strcpy(curthread->t_vmspace->progname, progname);
     curthread->t_vmspace->progfile = v;
@@ -66,31 +89,22 @@ runprogram(char *progname, int argc, char** argv) {
         return result;
     }
 
-    // array to hold user space addresses of the args
-    char* user_space_addr[argc+1];
-
-    // copy args into user space stack
-    int i;
-    for (i = argc - 1; i >= 0; i--) {
-        char* s = kstrdup(argv[i]);
-        s[strlen(s)] = '\0';
-        stackptr = stackptr - (strlen(s) + 1);
-        user_space_addr[i] = (char*) stackptr;
-        copyout(s, (userptr_t) stackptr, strlen(s) + 1);
-        kfree(s);
+    /* Copy the arguments onto the user stack. */
+    argbuf_init(&args);
+    for (i = 0; i < argc; i++) {
+        result = argbuf_add(&args, argv[i]);
+        if (result) {
+            argbuf_cleanup(&args);
+            return result;
+        }
+    }
+    result = argbuf_copyout(&args, &stackptr, &uargv);
+    argbuf_cleanup(&args);
+    if (result) {
+        return result;
     }
-    
-    // set last element to NULL
-    user_space_addr[argc] = NULL;
-
-    // align stack
-    stackptr = stackptr - (stackptr % 4);
-
-    // copy array of pointers to args to the user space
-    stackptr = stackptr - ((argc+1) * sizeof (char*));
-    copyout(user_space_addr, (userptr_t) stackptr, sizeof (user_space_addr));
 
-    md_usermode(argc, (userptr_t) stackptr, stackptr, entrypoint);
+    md_usermode(argc, uargv, stackptr, entrypoint);
 
     /* md_usermode does not return */
     panic("md_usermode returned\n");
@@ -0,0 +1,162 @@
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <thread.h>
+#include <curthread.h>
+#include <syscall.h>
+#include <sysstat.h>
+
+#define TRACE_CHUNK 16  // Records copied out per trip through spl
+
+static struct sysstat stats[SYSSTAT_MAXCALL];
+
+// Trace ring, records from ring_head for ring_count
+static struct systrace *ring;
+static unsigned ring_head, ring_count, ring_dropped;
+
+// Process being traced, 0 for all, -1 for none
+static int trace_pid = -1;
+
+static const char *const callnames[SYSSTAT_MAXCALL] = SYSSTAT_CALLNAMES;
+
+void sysstat_bootstrap() {
+    ring = kmalloc(SYSSTAT_RINGSIZE * sizeof(struct systrace));
+    if (ring == NULL)
+        panic("sysstat: Could not allocate the trace ring\n");
+    ring_head = ring_count = ring_dropped = 0;
+}
+
+// Histogram bucket for a call of USECS microseconds
+static int bucket(u_int32_t usecs) {
+    int b = 0;
+    while (usecs >= 2 && b < SYSSTAT_BUCKETS - 1) {
+        usecs >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void sysstat_record(int callno, const u_int32_t *args, int err,
+                    int32_t retval, u_int32_t usecs) {
+    struct sysstat *ss;
+    struct systrace *st;
+    int spl;
+
+    if (callno < 0 || callno >= SYSSTAT_MAXCALL) return;
+
+    spl = splhigh();
+    ss = &stats[callno];
+    ss->ss_calls++;
+    if (err) ss->ss_errors++;
+    ss->ss_usecs += usecs;
+    if (usecs > ss->ss_maxusecs) ss->ss_maxusecs = usecs;
+    ss->ss_hist[bucket(usecs)]++;
+
+    if (trace_pid >= 0 && ring != NULL &&
+            (trace_pid == 0 || trace_pid == (int) curthread->pid)) {
+        if (ring_count == SYSSTAT_RINGSIZE) {
+            // Full, drop the oldest
+            ring_head = (ring_head + 1) % SYSSTAT_RINGSIZE;
+            ring_count--;
+            ring_dropped++;
+        }
+        st = &ring[(ring_head + ring_count) % SYSSTAT_RINGSIZE];
+        st->st_pid = curthread->pid;
+        st->st_callno = callno;
+        memcpy(st->st_args, args, sizeof(st->st_args));
+        st->st_retval = err ? -1 : retval;
+        st->st_errno = err;
+        st->st_usecs = usecs;
+        ring_count++;
+    }
+    splx(spl);
+}
+
+// Takes up to LEN bytes of trace records, oldest first
+static int trace_copyout(userptr_t buf, int len, int32_t *retval) {
+    struct systrace chunk[TRACE_CHUNK];
+    unsigned i, n, want = len / sizeof(struct systrace), done = 0;
+    int spl, err;
+
+    while (done < want) {
+        spl = splhigh();
+        n = ring_count;
+        if (n > TRACE_CHUNK) n = TRACE_CHUNK;
+        if (n > want - done) n = want - done;
+        for (i = 0; i < n; i++) {
+            chunk[i] = ring[(ring_head + i) % SYSSTAT_RINGSIZE];
+        }
+        ring_head = (ring_head + n) % SYSSTAT_RINGSIZE;
+        ring_count -= n;
+        splx(spl);
+
+        if (n == 0) break;
+        // Records taken but not delivered are lost, as for a bad buffer
+        err = copyout(chunk, buf + done * sizeof(struct systrace),
+                n * sizeof(struct systrace));
+        if (err) return err;
+        done += n;
+    }
+    *retval = done;
+    return 0;
+}
+
+int sys_sysstat(int op, userptr_t buf, int len, int32_t *retval) {
+    struct sysstat *copy;
+    int spl, err;
+
+    switch (op) {
+        case SYSSTAT_STATS:
+            if (len < (int) sizeof(stats)) return EINVAL;
+            // Snapshot, so the table is consistent
+            copy = kmalloc(sizeof(stats));
+            if (copy == NULL) return ENOMEM;
+            spl = splhigh();
+            memcpy(copy, stats, sizeof(stats));
+            splx(spl);
+            err = copyout(copy, buf, sizeof(stats));
+            kfree(copy);
+            if (err) return err;
+            *retval = SYSSTAT_MAXCALL;
+            return 0;
+        case SYSSTAT_TRACE:
+            if (len < 0) return EINVAL;
+            return trace_copyout(buf, len, retval);
+        case SYSSTAT_RESET:
+            spl = splhigh();
+            bzero(stats, sizeof(stats));
+            ring_head = ring_count = ring_dropped = 0;
+            splx(spl);
+            return 0;
+        case SYSSTAT_SETTRACE:
+            if (len < -1) return EINVAL;
+            spl = splhigh();
+            trace_pid = len;
+            ring_head = ring_count = ring_dropped = 0;
+            splx(spl);
+            return 0;
+        case SYSSTAT_DROPPED:
+            *retval = ring_dropped;
+            return 0;
+    }
+    return EINVAL;
+}
+
+void sysstat_printstats() {
+    struct sysstat *ss;
+    int i;
+
+    kprintf("call          calls  errors   avg us   max us\n");
+    for (i = 0; i < SYSSTAT_MAXCALL; i++) {
+        ss = &stats[i];
+        if (ss->ss_calls == 0) continue;
+        if (callnames[i] != NULL) kprintf("%-12s", callnames[i]);
+        else kprintf("%-12d", i);
+        kprintf(" %6u  %6u  %7u  %7u\n", ss->ss_calls, ss->ss_errors,
+                ss->ss_usecs / ss->ss_calls, ss->ss_maxusecs);
+    }
+    kprintf("tracing %s, %u records queued, %u dropped\n",
+            trace_pid < 0 ? "off" : trace_pid == 0 ? "all" : "one process",
+            ring_count, ring_dropped);
+}
@@ -26,22 +26,27 @@ uiomove(void *ptr, size_t n, struct uio *uio)
 	}
 
 	while (n > 0 && uio->uio_resid > 0) {
-		iov = &uio->uio_iovec;
+		if (uio->uio_iovcnt == 0) {
+			/*
+			 * This should only happen if you set uio_resid
+			 * incorrectly (to more than the total length of
+			 * buffers the uio points to).
+			 */
+			panic("uiomove: ran out of buffers\n");
+		}
+		iov = uio->uio_iov;
+		if (iov->iov_len == 0) {
+			/* Used up (or empty to begin with); go to the next */
+			uio->uio_iov++;
+			uio->uio_iovcnt--;
+			continue;
+		}
 		size = iov->iov_len;
 
 		if (size > n) {
 			size = n;
 		}
 
-		if (size==0) {
-			/* 
-			 * This should only happen if you set uio_resid
-			 * incorrectly (to more than the total length of
-			 * buffers the uio points to). 
-			 */
-			panic("uiomove: size reached 0\n");
-		}
-
 		switch (uio->uio_segflg) {
 		    case UIO_SYSSPACE:
 			    result = 0;
@@ -115,9 +120,45 @@ mk_kuio(struct uio *uio, void *kbuf, size_t len, off_t pos, enum uio_rw rw)
 {
 	uio->uio_iovec.iov_kbase = kbuf;
 	uio->uio_iovec.iov_len = len;
+	uio->uio_iov = &uio->uio_iovec;
+	uio->uio_iovcnt = 1;
 	uio->uio_offset = pos;
 	uio->uio_resid = len;
 	uio->uio_segflg = UIO_SYSSPACE;
 	uio->uio_rw = rw;
 	uio->uio_space = NULL;
 }
+
+/*
+ * Convenience function to cons up a uio for user I/O. The data moves
+ * between the object and the user buffer with no kernel copy.
+ */
+void
+mk_uuio(struct uio *uio, userptr_t ubuf, size_t len, off_t pos,
+	enum uio_rw rw)
+{
+	uio->uio_iovec.iov_ubase = ubuf;
+	uio->uio_iovec.iov_len = len;
+	mk_uuiov(uio, &uio->uio_iovec, 1, pos, rw);
+}
+
+/*
+ * Convenience function to cons up a uio for scatter/gather user I/O.
+ */
+void
+mk_uuiov(struct uio *uio, struct iovec *iov, unsigned iovcnt, off_t pos,
+	 enum uio_rw rw)
+{
+	unsigned i;
+
+	uio->uio_iov = iov;
+	uio->uio_iovcnt = iovcnt;
+	uio->uio_offset = pos;
+	uio->uio_resid = 0;
+	for (i=0; i<iovcnt; i++) {
+		uio->uio_resid += iov[i].iov_len;
+	}
+	uio->uio_segflg = UIO_USERSPACE;
+	uio->uio_rw = rw;
+	uio->uio_space = curthread->t_vmspace;
+}
@@ -28,17 +28,133 @@
 #define DEBUG_RESET 0
 #define DEBUG_EXIT 0
 #define DEBUG_DEFINE_REGION 0
+#define OOM_MAXWAITS 5 // Seconds a fault waits for the OOM victim before giving up
 
 // For guarding the page directory temporarily
 
 struct lock* copy_on_write_lock;
-struct semaphore* memfullsemaphore;
+
+// Commit accounting, protected by splhigh
+int vm_overcommit_policy = VM_OVERCOMMIT_GUESS;
+unsigned vm_overcommit_ratio = 50;
+unsigned vm_committed = 0;
+
+// Frames fork leaves free for the kernel
+unsigned vm_kernreserve = 8;
+
+// All live address spaces, protected by splhigh
+static struct addrspace *as_list = NULL;
+
+// Zero filled frame shared by every untouched anonymous page
+paddr_t vm_zeropage = 0;
+unsigned vm_zeropage_maps = 0;
 
 void
 vm_bootstrap(void) {
     copy_on_write_lock = lock_create("Copy on Write");
     
-    memfullsemaphore = sem_create("MemFull", cm_totalframes - cm_totalkernelframes);
+    vaddr_t zero = alloc_kpages(1);
+    if (zero == 0)
+        panic("vm: Could not allocate the zero page\n");
+    bzero((void *) zero, PAGE_SIZE);
+    vm_zeropage = KVADDR_TO_PADDR(zero);
+}
+
+// Drops the TLB entry for vaddr, if there is one
+static
+void
+tlb_invalidate(vaddr_t vaddr) {
+    int i = TLB_Probe(vaddr & TLBHI_VPAGE, 0);
+    if (i >= 0)
+        TLB_Write(TLBHI_INVALID(i), TLBLO_INVALID(), i);
+}
+
+unsigned
+vm_commitlimit(void) {
+    unsigned userframes = cm_totalframes - cm_totalkernelframes;
+    return sm_pagecount + userframes * vm_overcommit_ratio / 100;
+}
+
+int
+vm_commit(unsigned npages) {
+    int spl = splhigh();
+    
+    if (vm_overcommit_policy == VM_OVERCOMMIT_GUESS) {
+        if (npages > sm_pagecount + cm_totalframes - cm_totalkernelframes) {
+            splx(spl);
+            return ENOMEM;
+        }
+    }
+    else if (vm_overcommit_policy == VM_OVERCOMMIT_NEVER) {
+        if (vm_committed + npages > vm_commitlimit()) {
+            splx(spl);
+            return ENOMEM;
+        }
+    }
+    
+    vm_committed += npages;
+    splx(spl);
+    return 0;
+}
+
+void
+vm_uncommit(unsigned npages) {
+    int spl = splhigh();
+    assert(vm_committed >= npages);
+    vm_committed -= npages;
+    splx(spl);
+}
+
+int
+vm_forkcheck(void) {
+    int spl = splhigh();
+    unsigned frames = cm_freeframes;
+    int slots = sm_freeslots;
+    splx(spl);
+
+    // With swap full, the child's first write needs a free frame too
+    if (frames < VM_FORKPAGES + vm_kernreserve + (slots == 0))
+        return ENOMEM;
+    return 0;
+}
+
+int
+vm_oomkill(struct addrspace *as) {
+    struct addrspace *a, *victim = NULL;
+    int spl = splhigh();
+    
+    // Somebody is already on the way out, give them time to exit
+    for (a = as_list; a != NULL; a = a->as_next) {
+        if (a->as_oomkill) {
+            victim = a;
+            break;
+        }
+    }
+    
+    if (victim == NULL) {
+        for (a = as_list; a != NULL; a = a->as_next) {
+            if (victim == NULL || a->as_commit > victim->as_commit)
+                victim = a;
+        }
+        assert(victim != NULL);
+        victim->as_oomkill = 1;
+    }
+    
+    if (victim != as && as->as_oomwaits++ < OOM_MAXWAITS) {
+        splx(spl);
+        return 0;
+    }
+    
+    as->as_oomkill = 1;
+    splx(spl);
+    return 1;
+}
+
+void
+vm_memwait(void) {
+    int spl = splhigh();
+    thread_sleep(&lbolt);
+    splx(spl);
 }
 
 /* Allocate/free some user-space virtual pages */
@@ -56,11 +172,12 @@ alloc_upages(int npages, vaddr_t vaddr) {
     return addr;
 }
 
-void
-zero_upages(vaddr_t addr) {
+paddr_t
+alloc_zeroupage(vaddr_t vaddr) {
     int spl = splhigh();
-    ram_zeromem(curthread->pid, addr);
+    paddr_t addr = ram_borrowzerouser(curthread->pid, vaddr);
     splx(spl);
+    return addr;
 }
 
 void
@@ -114,6 +231,7 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
     u_int32_t ehi, elo;
     struct addrspace *as;
     int spl;
+    int zerofill = 0;
 
     spl = splhigh();
 
@@ -121,8 +239,11 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
 
     switch (faulttype) {
         case VM_FAULT_READONLY:
-            /* We always create pages read-write, so we can't get this */
-            panic("dumbvm: got VM_FAULT_READONLY\n");
+            // Only the zero page is mapped read-only. Drop the mapping and
+            // give the page its own frame.
+            tlb_invalidate(faultaddress);
+            faulttype = VM_FAULT_WRITE;
+            break;
         case VM_FAULT_READ:
         case VM_FAULT_WRITE:
             break;
@@ -166,8 +287,14 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
                 p->V = 1;
                 p->R = 1;
                 p->PFN = 0;
-                p_allocate_page(p); // Allocate disk space for page
-                sm_swapin(p, faultaddress); // Swap the page from the disk
+                if (p_allocate_page(p) || sm_swapin(p, faultaddress)) {
+                    // Keep sharing the old frame until memory frees up
+                    if (p->V == 0 && p->PFN != 0) sm_swapdealloc(p);
+                    p->V = 1;
+                    p->PFN = copyfrom;
+                    lock_release(copy_on_write_lock);
+                    goto oom;
+                }
                 unsigned copyto = p->PFN;
                 
                 if (DEBUG_COPY_ON_WRITE) kprintf("COPY ON WRITE %d -> %d\n", copyfrom, copyto);
@@ -198,8 +325,14 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
         p->PFN = 0;
         p->F = 0;
         
-        p_allocate_page(p); // Allocate disk space for page
-        sm_swapin(p, faultaddress); // Swap the page from the disk
+        if (p_allocate_page(p) || sm_swapin(p, faultaddress)) {
+            // Put the page back on file so the fault can be retried
+            if (p->V == 0 && p->PFN != 0) sm_swapdealloc(p);
+            p->V = 0;
+            p->F = 1;
+            p->PFN = (segment << TEXT_SEGMENT_SHIFT) + part;
+            goto oom;
+        }
         
         paddr = (p->PFN << 12);
         load_elf_segment(segment, part);
@@ -209,18 +342,21 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
 
     // Page valid, unallocated
     
-    if (p->F == 0 && p->V == 1 && p->PFN == 0) {
-        p_allocate_page(p); // Allocate disk space for page
-        sm_swapin(p, faultaddress); // Swap the page from the disk
+    if (p->F == 0 && p->V == 1 && p->PFN == 0 && faulttype == VM_FAULT_READ) {
+        paddr = vm_zeropage;
+        zerofill = 1;
+        goto tlbload;
+    }
+    else if (p->F == 0 && p->V == 1 && p->PFN == 0) {
+        if (sm_zerofill(p, faultaddress)) goto oom; // First write, take a zeroed frame
         paddr = (p->PFN << 12);
-
-        return 0;
+        goto tlbload;
     }
 
     // Page located on disk
     if (!p->V && p->PFN) {
         as->stackcount = 0;
-        sm_swapin(p, faultaddress);
+        if (sm_swapin(p, faultaddress)) goto oom;
         paddr = (p->PFN << 12);
     }
 
@@ -231,46 +367,63 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
 
         // Fault location is part of stack (Temporary solution to stack growth method)
         if (faultaddress <= as->as_stacklocation && faultaddress > (as->as_stacklocation - MAX_STACK_GROWTH)) {
-            unsigned addr = as->as_stacklocation - PAGE_SIZE;
+            // Top page to add, the faulted one itself if it is at the location
+            vaddr_t top = as->as_stacklocation - PAGE_SIZE;
+            vaddr_t addr;
+            if (top < faultaddress) top = faultaddress;
             
             // Infinite loop counter
             if (as->stackcount++ == 100) {
                 kprintf("Infinite Loop Detected\n");
                 goto tlbfault;
             }
-                
-            // Request pages for a jump
-            while (addr > faultaddress) {
-                struct page* pp = pd_request_page(&as->page_directory, addr);
+            
+            // Every page of a jump, down to the one faulted on, must be
+            // unused; check before charging so a refusal leaves nothing
+            struct page* pp;
+            for (addr = top; addr >= faultaddress; addr -= PAGE_SIZE) {
+                pp = pd_request_page(&as->page_directory, addr);
                 if (pp->PFN != 0 || pp->F != 0 || pp->V != 0) {
                     kprintf("Page has hit the bottom\n");
                     goto tlbfault; // Page has hit the bottom
                 }
+            }
+
+            // Stack growth is charged when it happens
+            unsigned growth = (as->as_stacklocation - faultaddress) / PAGE_SIZE;
+            if (vm_commit(growth)) {
+                if (DEBUG_VMFAULTERROR) kprintf("Stack growth of %d pages refused\n", growth);
+                goto tlbfault;
+            }
+            as->as_commit += growth;
+
+            for (addr = top; addr >= faultaddress; addr -= PAGE_SIZE) {
+                pp = pd_request_page(&as->page_directory, addr);
                 pp->V = 1;
                 pp->Prot = 3;
-                addr = addr - PAGE_SIZE;
             }
 
-            // The page that actually is requested
-            struct page* pp = pd_request_page(&as->page_directory, faultaddress);
-            if (pp->PFN != 0 || pp->F != 0 || pp->V != 0) {
-                kprintf("Page has hit the bottom\n");
-                goto tlbfault; // Page has hit the bottom
+            // pp is now the page that actually is requested
+            as->as_stacklocation = faultaddress; // Shrink the stack location, stack location is never freed
+            if (faulttype == VM_FAULT_READ) {
+                paddr = vm_zeropage;
+                zerofill = 1;
+                goto tlbload;
             }
-            pp->V = 1;
-            pp->Prot = 3;
-            p_allocate_page(pp); // Allocate disk space for page
-            sm_swapin(pp, faultaddress); // Swap the page from the disk
+            if (sm_zerofill(pp, faultaddress)) goto oom; // First write, take a zeroed frame
             paddr = (pp->PFN << 12);
-            as->as_stacklocation = faultaddress; // Shrink the stack location, stack location is never freed
 
         } else if (faultaddress >= as->as_heap_start && faultaddress <= as->as_heap_end) {
             struct page* pp = pd_request_page(&as->page_directory, faultaddress);
             if (pp->PFN != 0 || pp->F != 0 || pp->V != 0) goto tlbfault;
             pp->V = 1;
             pp->Prot = 3;
-            p_allocate_page(pp); // Allocate disk space for page
-            sm_swapin(pp, faultaddress); // Swap the page from the disk
+            if (faulttype == VM_FAULT_READ) {
+                paddr = vm_zeropage;
+                zerofill = 1;
+                goto tlbload;
+            }
+            if (sm_zerofill(pp, faultaddress)) goto oom; // First write, take a zeroed frame
             paddr = (pp->PFN << 12);
         } else {
             //kprintf("Invalid Page\n");
@@ -278,6 +431,7 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
         }
     }
         
+tlbload:
     // TLB Stuff
     assert((paddr & PAGE_FRAME) == paddr);
     for (i = 0; i < NUM_TLB; i++) {
@@ -290,15 +444,31 @@ vm_fault(int faulttype, vaddr_t faultaddress) {
 
         // If the physical page is invalid, replace the TLB entry with the new page
         ehi = faultaddress;
-        elo = paddr | TLBLO_DIRTY | TLBLO_VALID;
+        elo = paddr | TLBLO_VALID;
+        if (zerofill)
+            vm_zeropage_maps++;
+        else
+            elo |= TLBLO_DIRTY;
         DEBUG(DB_VM, "  smartvm:%d 0x%x -> 0x%x\n", faulttype, faultaddress, paddr); // Prints all the mapping in the TLB
         TLB_Write(ehi, elo, i);
+        as->as_oomwaits = 0;
         splx(spl);
         return 0;
     }
     kprintf("Ran out of TLB entries - cannot handle page fault\n");
     goto tlbfault;
 
+oom:
+    // Out of memory and swap. Either somebody else is killed and we retry the
+    // fault once they have exited, or we are the one that has to go.
+    splx(spl);
+    if (vm_oomkill(as)) {
+        kprintf("Out of memory: killing PID %d\n", curthread->pid);
+        return ENOMEM;
+    }
+    vm_memwait();
+    return 0;
+
 tlbfault:
     if (DEBUG_VMFAULTERROR) {
         kprintf("\n-------------------- VM Fault Info --------------------\n");
@@ -342,6 +512,16 @@ as_create(void) {
     
     as->stackcount = 0;
     
+    as->as_commit = 0;
+    as->as_heap_max = 0;
+    as->as_oomkill = 0;
+    as->as_oomwaits = 0;
+    
+    int spl = splhigh();
+    as->as_next = as_list;
+    as_list = as;
+    splx(spl);
+    
     return as;
 }
 
@@ -384,6 +564,10 @@ as_reset(struct addrspace *as) {
     as->lruclock = NULL;
     as->lruhandle = NULL;
     
+    vm_uncommit(as->as_commit);
+    as->as_commit = 0;
+    as->as_heap_max = 0;
+    
     if(DEBUG_RESET) {
         int spl = splhigh();
         kprintf("Coremap After\n");
@@ -420,6 +604,18 @@ as_destroy(struct addrspace *as) {
     lock_release(copy_on_write_lock);
     
     lock_destroy(as->pdlock);
+    
+    int spl = splhigh();
+    struct addrspace **a;
+    for (a = &as_list; *a != NULL; a = &(*a)->as_next) {
+        if (*a == as) {
+            *a = as->as_next;
+            break;
+        }
+    }
+    splx(spl);
+    
+    vm_uncommit(as->as_commit);
     kfree(as);
     
     if(DEBUG_EXIT) {
@@ -475,6 +671,10 @@ as_define_region(struct addrspace *as, vaddr_t vaddr, int pindex, size_t sz,
     sz = (sz + PAGE_SIZE - 1) & PAGE_FRAME;
 
     npages = sz / PAGE_SIZE;
+    
+    if (vm_commit(npages))
+        return ENOMEM;
+    as->as_commit += npages;
 
     // Get the page and set the valid to one
 
@@ -505,11 +705,33 @@ as_define_region(struct addrspace *as, vaddr_t vaddr, int pindex, size_t sz,
     return 0;
 }
 
+void
+as_define_bss(struct addrspace *as, vaddr_t vaddr, size_t sz) {
+    vaddr_t end = (vaddr + sz + PAGE_SIZE - 1) & PAGE_FRAME;
+    
+    // Pages with file data in them still have to be read from the file
+    vaddr = (vaddr + PAGE_SIZE - 1) & PAGE_FRAME;
+    
+    lock_acquire(as->pdlock);
+    for (; vaddr < end; vaddr += PAGE_SIZE) {
+        struct page* p = pd_request_page(&as->page_directory, vaddr);
+        p->F = 0;
+        p->V = 1;
+        p->PFN = 0;
+    }
+    lock_release(as->pdlock);
+}
+
 int
 as_prepare_load(struct addrspace *as) {
 
     DEBUG(DB_VM, "as_prepare_load\n");
 
+    // The first stack page, the rest is charged as the stack grows
+    if (vm_commit(1))
+        return ENOMEM;
+    as->as_commit++;
+
     // Setup the USER STACK pages
     pd_request_page(&as->page_directory, USERSTACK - PAGE_SIZE);
     as->as_stacklocation = USERSTACK - PAGE_SIZE;
@@ -540,10 +762,16 @@ int
 as_copy(struct addrspace *old, struct addrspace **ret) {
     DEBUG(DB_VM, "as_copy\n");
 
+    // The child can touch everything the parent could
+    if (vm_commit(old->as_commit))
+        return ENOMEM;
+
     struct addrspace *newas = as_create();
     if (newas == NULL) {
+        vm_uncommit(old->as_commit);
         return ENOMEM;
     }
+    newas->as_commit = old->as_commit;
 
     strcpy(newas->progname, old->progname);
 
@@ -556,6 +784,7 @@ as_copy(struct addrspace *old, struct addrspace **ret) {
     newas->as_stacklocation = old->as_stacklocation;
     newas->as_heap_start = old->as_heap_start;
     newas->as_heap_end = old->as_heap_end;
+    newas->as_heap_max = old->as_heap_max;
     newas->as_data = old->as_data;
 
     // Make a copy of the page directory
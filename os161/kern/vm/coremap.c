@@ -4,35 +4,47 @@
 #include <vm.h>
 
 struct coremap_entry *coremap = NULL;
+struct coremap_rmap *cm_rmap = NULL;
 unsigned cm_totalframes, cm_totalkernelframes;
+unsigned cm_freeframes;
 paddr_t firstpaddr, lastpaddr; // First physical address, used as offset
 
 void coremap_bootstrap() {
     ram_getsize((u_int32_t *) &firstpaddr, (u_int32_t *) &lastpaddr);
-    
+
     cm_totalframes = (lastpaddr - firstpaddr) / PAGE_SIZE;
-    coremap = kmalloc(cm_totalframes * sizeof(struct coremap_entry));
-    
+
+    // Both arrays are stolen before the coremap is published
+    struct coremap_entry *cm = kmalloc(cm_totalframes * sizeof(struct coremap_entry));
+    cm_rmap = kmalloc(cm_totalframes * sizeof(struct coremap_rmap));
+    if (cm == NULL || cm_rmap == NULL)
+        panic("coremap: Could not allocate the coremap\n");
+
     unsigned i;
-    u_int32_t addr = firstpaddr;
     for (i = 0; i < cm_totalframes; i++) {
-        coremap[i].addr = addr;
-        addr = addr + PAGE_SIZE;
-        coremap[i].usedby = CM_FREE;
-        coremap[i].pid = 0;
-        coremap[i].vaddr = 0; // Virtual Address is 0;
-        coremap[i].length = 0;
+        cm[i].usedby = CM_FREE;
+        cm[i].cont = 0;
+        cm[i].flags = 0;
+        cm[i].usecount = 0;
+        cm_rmap[i].vpn = 0; // Virtual Address is 0;
+        cm_rmap[i].pid = 0;
     }
-    
+
     // Get Coremap usage
     u_int32_t lo, hi;
     ram_getsize(&lo, &hi);
-    
+
     int spaceleft = (hi - lo) / PAGE_SIZE;
-    
+
     for (i = 0; i < cm_totalframes - spaceleft; i++) {
-        coremap[i].usedby = CM_COREMAP;
+        cm[i].usedby = CM_COREMAP;
     }
+    cm_freeframes = spaceleft;
+
+    coremap = cm;
+
+    kprintf("Coremap: %d frames, %d bytes per frame\n", cm_totalframes,
+            (int) (sizeof(struct coremap_entry) + sizeof(struct coremap_rmap)));
 }
 
 void coremap_getkernelusage() {
@@ -43,11 +55,11 @@ void coremap_getkernelusage() {
         if(coremap[i].usedby == CM_KTEMP) {
             coremap[i].usedby = CM_KERNEL;
             kernelcount++;
-        }   
+        }
     }
-    
+
     cm_totalkernelframes = kernelcount;
-    
+
     cm_print();
 }
 
@@ -61,15 +73,22 @@ unsigned cm_getframefromaddress(paddr_t paddr) {
     return (paddr - firstpaddr) >> 12;
 }
 
+paddr_t cm_getaddressfromframe(unsigned frame) {
+    assert(frame < cm_totalframes);
+    return firstpaddr + (frame << 12);
+}
+
 struct coremap_entry* cm_getcmentryfromaddress(paddr_t paddr) {
-    assert(paddr <= lastpaddr);
-    if(paddr <= firstpaddr) {
-        kprintf("Address requested invalid\n");
-        kprintf("0x%x - 0x%x", paddr, firstpaddr);
+    return &coremap[cm_getframefromaddress(paddr)];
+}
+
+// Number of frames in the allocation starting at frame
+unsigned cm_runlength(unsigned frame) {
+    unsigned i = frame + 1;
+    while (i < cm_totalframes && coremap[i].cont) {
+        i++;
     }
-    assert(paddr > firstpaddr);
-    int id = (paddr - firstpaddr) >> 12;
-    return &coremap[id];
+    return i - frame;
 }
 
 void cm_print() {
@@ -77,11 +96,11 @@ void cm_print() {
     kprintf("\nFrame #\tPHY ADDR\tLength\tCount\tUSER\n");
     for (i = 0; i < cm_totalframes; i++) {
         if (coremap[i].usedby == CM_FREE) continue;
-        
-        kprintf("%d:\t0x%x\t", i, coremap[i].addr);
-        kprintf("\t%d", coremap[i].length);
+
+        kprintf("%d:\t0x%x\t", i, cm_getaddressfromframe(i));
+        kprintf("\t%d", coremap[i].cont ? 0 : cm_runlength(i));
         kprintf("\t%d\t", coremap[i].usecount);
-        
+
         if (coremap[i].usedby == CM_COREMAP)
             kprintf("COREMAP\n");
         if (coremap[i].usedby == CM_KERNEL)
@@ -89,6 +108,6 @@ void cm_print() {
         if (coremap[i].usedby == CM_KTEMP)
             kprintf("KTEMP\n");
         if (coremap[i].usedby == CM_USED)
-            kprintf("PID %d, VA: 0x%x\n", coremap[i].pid, coremap[i].vaddr);
+            kprintf("PID %d, VA: 0x%x\n", cm_rmap[i].pid, cm_rmap[i].vpn << 12);
     }
 }
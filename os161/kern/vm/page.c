@@ -5,14 +5,15 @@
 #include "curthread.h"
 #include "thread.h"
 
-void p_allocate_page(struct page* p) {
+int p_allocate_page(struct page* p) {
     assert(p->V == 1);
     assert(p->PFN == 0);
     
     // Allocates a disk location for the page
     if (p->PFN == 0 && p->V == 1) {
-        sm_swapalloc(p);
+        return sm_swapalloc(p);
     }
+    return 0;
 }
 
 void p_print(struct page* p, int table, int page) {
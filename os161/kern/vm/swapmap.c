@@ -12,8 +12,14 @@
 #include <kern/errno.h>
 
 #include "synch.h"
+#include "opt-zswap.h"
+
+#if OPT_ZSWAP
+#include <zswap.h>
+#endif
 
 int sm_pagecount;
+int sm_freeslots;
 struct vnode *swap_fp;
 Swapmap* swapmap;
 struct lock* swapmaplock;
@@ -40,10 +46,14 @@ void sm_bootstrap() {
 
     // bitmap
     swapmap = bitmap_create(sm_pagecount);
+    sm_freeslots = sm_pagecount;
     
     // Swap lock (for Copy and write)
     swapmaplock = lock_create("Swap Lock");
     
+#if OPT_ZSWAP
+    zswap_bootstrap();
+#endif
 }
 
 void sm_print() {
@@ -94,6 +104,11 @@ int sm_swapalloc(struct page* p) {
         }
     }
     
+    // Swap is full, the caller has to free memory first
+    if (pos == sm_pagecount) {
+        lock_release(swapmaplock);
+        return ENOMEM;
+    }
 
     // Updates the page to point to the address in the swap file
     // Sets valid to false so OS will know it is disk address
@@ -146,13 +161,28 @@ int sm_swapout(struct page* p, vaddr_t vaddr) {
         }
     }
     
-    // Create a kernel UIO to prepare to write
-    struct uio ku;
-    mk_kuio(&ku, (void *) PADDR_TO_KVADDR((p->PFN << 12)), PAGE_SIZE, pos * PAGE_SIZE, UIO_WRITE);
-
-    // Writes the swapped page into the disk
-    int result = VOP_WRITE(swap_fp, &ku);
-    if (result) return result;
+    if (pos == sm_pagecount) {
+        lock_release(swapmaplock);
+        return ENOMEM;
+    }
+    
+    int result = 1;
+#if OPT_ZSWAP
+    // Keep it compressed in memory if it fits
+    result = zswap_store(pos, PADDR_TO_KVADDR((p->PFN << 12)));
+#endif
+    if (result) {
+        // Create a kernel UIO to prepare to write
+        struct uio ku;
+        mk_kuio(&ku, (void *) PADDR_TO_KVADDR((p->PFN << 12)), PAGE_SIZE, pos * PAGE_SIZE, UIO_WRITE);
+
+        // Writes the swapped page into the disk
+        result = VOP_WRITE(swap_fp, &ku);
+        if (result) {
+            lock_release(swapmaplock);
+            return result;
+        }
+    }
     
     // Deallocates the page from memory. Page will automatically be invalidated upon free
     p_free_frame(p);
@@ -174,21 +204,19 @@ int sm_swapout(struct page* p, vaddr_t vaddr) {
     return 0;
 }
 
-int sm_swapin(struct page* p, vaddr_t vaddr) {
-    // The page must be invalid to be swapped in
-    assert(p->V == 0);
-    assert(p->PFN != 0);
-    
-    int pos = p->PFN - 1;
-
-    // Allocates a space on memory for the swapped in area
-    paddr_t paddr = alloc_upages(1, vaddr);
+// Gets a frame for vaddr, evicting one of our own pages if memory is full.
+// Returns 0 if there is nothing left to evict.
+static paddr_t sm_getframe(vaddr_t vaddr, int zero) {
+    paddr_t paddr = zero ? alloc_zeroupage(vaddr) : alloc_upages(1, vaddr);
 
     // Ran out of memory to swap in, swaps out something else from the local
     if (paddr == 0) {
 //        kprintf("RUN OUT OF MEMORY\n");
         //cm_print();
         
+        // Nothing of our own left to evict
+        if (curthread->t_vmspace->lruclock == NULL)
+            return 0;
         
         vaddr_t swapoutaddr = findnextlruclockframe();
         assert(swapoutaddr != vaddr);
@@ -205,9 +233,10 @@ int sm_swapin(struct page* p, vaddr_t vaddr) {
             sm_print_debug();
             cm_print();
         }
-        sm_swapout(p, swapoutaddr);
+        if (sm_swapout(p, swapoutaddr))
+            return 0;
         // Swap in the memory again
-        paddr = alloc_upages(1, vaddr);
+        paddr = zero ? alloc_zeroupage(vaddr) : alloc_upages(1, vaddr);
         
         if(DEBUG_SWAP) {
             kprintf("After\n");
@@ -215,16 +244,37 @@ int sm_swapin(struct page* p, vaddr_t vaddr) {
             cm_print();
             kprintf("-------------------------------------------------");
         }
-        assert(paddr != 0);
     }
+    
+    return paddr;
+}
 
-    // Create a kernel UIO to prepare to read the location from the page frame number to memory
-    struct uio ku;
-    mk_kuio(&ku, (void *) PADDR_TO_KVADDR(paddr), PAGE_SIZE, pos * PAGE_SIZE, UIO_READ);
+int sm_swapin(struct page* p, vaddr_t vaddr) {
+    // The page must be invalid to be swapped in
+    assert(p->V == 0);
+    assert(p->PFN != 0);
     
+    int pos = p->PFN - 1;
+
+    // Allocates a space on memory for the swapped in area
+    paddr_t paddr = sm_getframe(vaddr, 0);
+    if (paddr == 0)
+        return ENOMEM;
 
-    // Reads from the UIO into the memory specified by paddr
-    int result = VOP_READ(swap_fp, &ku);
+    int result = 1;
+#if OPT_ZSWAP
+    lock_acquire(swapmaplock);
+    result = zswap_load(pos, PADDR_TO_KVADDR(paddr));
+    lock_release(swapmaplock);
+#endif
+    if (result) {
+        // Create a kernel UIO to prepare to read the location from the page frame number to memory
+        struct uio ku;
+        mk_kuio(&ku, (void *) PADDR_TO_KVADDR(paddr), PAGE_SIZE, pos * PAGE_SIZE, UIO_READ);
+
+        // Reads from the UIO into the memory specified by paddr
+        result = VOP_READ(swap_fp, &ku);
+    }
 
     // Updates the bitmap to indicate the swap area is now freed
     lock_acquire(swapmaplock);
@@ -244,6 +294,23 @@ int sm_swapin(struct page* p, vaddr_t vaddr) {
     return 0;
 }
 
+int sm_zerofill(struct page* p, vaddr_t vaddr) {
+    // The page must be valid and never allocated
+    assert(p->V);
+    assert(p->PFN == 0);
+    
+    paddr_t paddr = sm_getframe(vaddr, 1);
+    if (paddr == 0)
+        return ENOMEM;
+    
+    p->PFN = (paddr >> 12);
+    p->R = 1;
+    
+    push_end(&(curthread->t_vmspace->lruclock), vaddr);
+    
+    return 0;
+}
+
 int sm_swapdecrement(struct page* p) {
     assert(p->PFN != 0);
     
@@ -254,6 +321,10 @@ int sm_swapdecrement(struct page* p) {
     // If marked only once, decrement marker
     if (n == NULL) {
         bitmap_unmark(swapmap, pos);
+        sm_freeslots++;
+#if OPT_ZSWAP
+        zswap_invalidate(pos);
+#endif
         return 1;
     }        // If marked once, remove the value and unmark
     else if (SWAPCOUNT_COUNT(n->val) == 1) {
@@ -277,6 +348,7 @@ int sm_swapincrement(struct page* p) {
     // If unmarked, simply mark it
     if (b == 0) {
         bitmap_mark(swapmap, pos);
+        sm_freeslots--;
         if (DEBUG_SWAPMAP) sm_print_debug();
         return 0;
     }
@@ -0,0 +1,284 @@
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <vm.h>
+#include <swapmap.h>
+#include <zswap.h>
+
+#define CHUNKS_PER_PAGE (PAGE_SIZE / ZSWAP_CHUNK)
+#define HASH_BITS 10
+#define DEBUG_ZSWAP 0
+
+// Where a swap slot lives in the pool
+struct zswap_entry {
+    u_int32_t valid     : 1;
+    u_int32_t page      : 7;    // Pool page
+    u_int32_t chunk     : 6;    // First chunk in the pool page
+    u_int32_t len       : 13;   // Compressed length in bytes
+    u_int32_t unused    : 5;
+};
+
+struct zswap_stats zswap_stats;
+int zswap_enabled = 1;
+
+static struct zswap_entry *zswap_map;  // One entry per swap slot
+static vaddr_t zswap_pool[ZSWAP_POOLPAGES];
+static u_int32_t zswap_used[ZSWAP_POOLPAGES][CHUNKS_PER_PAGE / 32];
+
+// Compressor scratch space, protected by swapmaplock like the rest
+static u_int16_t hashtab[1 << HASH_BITS];
+static u_int8_t zbuf[ZSWAP_MAXSIZE];
+
+void zswap_bootstrap() {
+    int i;
+
+    zswap_map = kmalloc(sm_pagecount * sizeof(struct zswap_entry));
+    if (zswap_map == NULL)
+        panic("zswap: Could not allocate the slot map\n");
+    bzero(zswap_map, sm_pagecount * sizeof(struct zswap_entry));
+
+    for (i = 0; i < ZSWAP_POOLPAGES; i++) {
+        zswap_pool[i] = alloc_kpages(1);
+        if (zswap_pool[i] == 0)
+            panic("zswap: Could not allocate the pool\n");
+    }
+    bzero(zswap_used, sizeof(zswap_used));
+    bzero(&zswap_stats, sizeof(zswap_stats));
+
+    kprintf("zswap: %d KB pool\n", ZSWAP_POOLPAGES * PAGE_SIZE / 1024);
+}
+
+////////////////////////////////////////
+//
+// LZ77 compressor, LZ4 block format restricted to one page.
+// A token byte holds the literal count in the high nibble and the match
+// length minus 4 in the low nibble, 15 means more length bytes follow.
+
+static unsigned hash4(const u_int8_t *p) {
+    u_int32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((u_int32_t) p[3] << 24);
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static u_int8_t *put_len(u_int8_t *op, unsigned len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+// Returns the compressed length, or 0 if it does not fit in max bytes
+static unsigned lz_compress(const u_int8_t *src, u_int8_t *dst, unsigned max) {
+    const u_int8_t *ip = src, *anchor = src;
+    const u_int8_t *end = src + PAGE_SIZE;
+    const u_int8_t *limit = end - 8; // The tail is always sent as literals
+    u_int8_t *op = dst, *oend = dst + max;
+    unsigned litlen, mlen;
+
+    bzero(hashtab, sizeof(hashtab));
+
+    while (ip < limit) {
+        unsigned h = hash4(ip);
+        const u_int8_t *ref = src + hashtab[h];
+        hashtab[h] = ip - src;
+
+        if (ref >= ip || ref[0] != ip[0] || ref[1] != ip[1] ||
+                ref[2] != ip[2] || ref[3] != ip[3]) {
+            ip++;
+            continue;
+        }
+
+        const u_int8_t *mp = ip + 4, *rp = ref + 4;
+        while (mp < limit && *mp == *rp) {
+            mp++;
+            rp++;
+        }
+
+        litlen = ip - anchor;
+        mlen = mp - ip - 4;
+        if (op + 1 + litlen + litlen / 255 + 1 + 2 + mlen / 255 + 1 > oend)
+            return 0;
+
+        u_int8_t *token = op++;
+        *token = (litlen >= 15 ? 15 : litlen) << 4;
+        if (litlen >= 15) op = put_len(op, litlen - 15);
+        memcpy(op, anchor, litlen);
+        op += litlen;
+
+        *op++ = (ip - ref) & 0xff;
+        *op++ = (ip - ref) >> 8;
+        *token |= (mlen >= 15 ? 15 : mlen);
+        if (mlen >= 15) op = put_len(op, mlen - 15);
+
+        ip = anchor = mp;
+    }
+
+    litlen = end - anchor;
+    if (op + 1 + litlen + litlen / 255 + 1 > oend)
+        return 0;
+    *op++ = (litlen >= 15 ? 15 : litlen) << 4;
+    if (litlen >= 15) op = put_len(op, litlen - 15);
+    memcpy(op, anchor, litlen);
+    op += litlen;
+
+    return op - dst;
+}
+
+static void lz_decompress(const u_int8_t *src, unsigned len, u_int8_t *dst) {
+    const u_int8_t *ip = src, *iend = src + len;
+    u_int8_t *op = dst;
+    unsigned token, litlen, mlen, off, b;
+
+    while (1) {
+        token = *ip++;
+
+        litlen = token >> 4;
+        if (litlen == 15) {
+            do {
+                b = *ip++;
+                litlen += b;
+            } while (b == 255);
+        }
+        memcpy(op, ip, litlen);
+        op += litlen;
+        ip += litlen;
+        if (ip >= iend) break;
+
+        off = ip[0] | (ip[1] << 8);
+        ip += 2;
+        mlen = token & 15;
+        if (mlen == 15) {
+            do {
+                b = *ip++;
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += 4;
+
+        // Byte at a time, the match may overlap what it is producing
+        const u_int8_t *ref = op - off;
+        while (mlen--) *op++ = *ref++;
+    }
+
+    assert(op == dst + PAGE_SIZE);
+}
+
+////////////////////////////////////////
+//
+// Pool chunks
+
+static int chunk_isset(int page, int chunk) {
+    return (zswap_used[page][chunk / 32] >> (chunk % 32)) & 1;
+}
+
+static void chunk_set(int page, int chunk, int nchunks, int used) {
+    int i;
+    for (i = chunk; i < chunk + nchunks; i++) {
+        if (used)
+            zswap_used[page][i / 32] |= (1 << (i % 32));
+        else
+            zswap_used[page][i / 32] &= ~(1 << (i % 32));
+    }
+    zswap_stats.zs_poolused += used ? nchunks : -nchunks;
+}
+
+// Finds nchunks free chunks in a row inside one pool page
+static int chunk_alloc(int nchunks, int *page, int *chunk) {
+    int p, c, run;
+    for (p = 0; p < ZSWAP_POOLPAGES; p++) {
+        run = 0;
+        for (c = 0; c < CHUNKS_PER_PAGE; c++) {
+            run = chunk_isset(p, c) ? 0 : run + 1;
+            if (run == nchunks) {
+                *page = p;
+                *chunk = c - nchunks + 1;
+                chunk_set(p, *chunk, nchunks, 1);
+                return 0;
+            }
+        }
+    }
+    return ENOSPC;
+}
+
+////////////////////////////////////////
+//
+// Swap interface
+
+int zswap_store(int slot, vaddr_t kvaddr) {
+    int page, chunk;
+
+    assert(slot >= 0 && slot < sm_pagecount);
+    assert(!zswap_map[slot].valid);
+
+    if (!zswap_enabled)
+        return ENOSPC;
+
+    unsigned len = lz_compress((const u_int8_t *) kvaddr, zbuf, ZSWAP_MAXSIZE);
+    if (len == 0) {
+        zswap_stats.zs_rejected++;
+        return ENOSPC;
+    }
+
+    int nchunks = (len + ZSWAP_CHUNK - 1) / ZSWAP_CHUNK;
+    if (chunk_alloc(nchunks, &page, &chunk)) {
+        zswap_stats.zs_full++;
+        return ENOSPC;
+    }
+
+    memcpy((void *) (zswap_pool[page] + chunk * ZSWAP_CHUNK), zbuf, len);
+    zswap_map[slot].valid = 1;
+    zswap_map[slot].page = page;
+    zswap_map[slot].chunk = chunk;
+    zswap_map[slot].len = len;
+
+    zswap_stats.zs_stores++;
+    zswap_stats.zs_bytesin += PAGE_SIZE;
+    zswap_stats.zs_bytesout += len;
+
+    if (DEBUG_ZSWAP) kprintf("zswap: slot %d -> %d bytes\n", slot, len);
+    return 0;
+}
+
+int zswap_load(int slot, vaddr_t kvaddr) {
+    assert(slot >= 0 && slot < sm_pagecount);
+
+    struct zswap_entry *e = &zswap_map[slot];
+    if (!e->valid) {
+        zswap_stats.zs_misses++;
+        return ENOENT;
+    }
+
+    lz_decompress((const u_int8_t *) (zswap_pool[e->page] + e->chunk * ZSWAP_CHUNK),
+            e->len, (u_int8_t *) kvaddr);
+    zswap_stats.zs_hits++;
+    return 0;
+}
+
+void zswap_invalidate(int slot) {
+    assert(slot >= 0 && slot < sm_pagecount);
+
+    struct zswap_entry *e = &zswap_map[slot];
+    if (!e->valid)
+        return;
+
+    chunk_set(e->page, e->chunk, (e->len + ZSWAP_CHUNK - 1) / ZSWAP_CHUNK, 0);
+    e->valid = 0;
+}
+
+void zswap_printstats() {
+    struct zswap_stats *s = &zswap_stats;
+    unsigned loads = s->zs_hits + s->zs_misses;
+    unsigned tries = s->zs_stores + s->zs_rejected + s->zs_full;
+
+    kprintf("zswap: %s, pool %d/%d chunks used\n", zswap_enabled ? "on" : "off",
+            s->zs_poolused, ZSWAP_POOLPAGES * CHUNKS_PER_PAGE);
+    kprintf("  stores %d of %d (%d incompressible, %d pool full)\n",
+            s->zs_stores, tries, s->zs_rejected, s->zs_full);
+    kprintf("  loads %d from pool, %d from disk, hit rate %d%%\n",
+            s->zs_hits, s->zs_misses, loads ? s->zs_hits * 100 / loads : 0);
+    kprintf("  compression %d KB -> %d KB, ratio %d.%02d\n",
+            s->zs_bytesin / 1024, s->zs_bytesout / 1024,
+            s->zs_bytesout ? s->zs_bytesin / s->zs_bytesout : 0,
+            s->zs_bytesout ? (s->zs_bytesin % s->zs_bytesout) * 100 / s->zs_bytesout : 0);
+}
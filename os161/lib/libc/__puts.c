@@ -10,11 +10,5 @@
 int
 __puts(const char *str)
 {
-	int count=0;
-	while (*str) {
-		putchar(*str);
-		str++;
-		count++;
-	}
-	return count;
+	return fputs(str, stdout);
 }
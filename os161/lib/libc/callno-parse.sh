@@ -6,6 +6,10 @@
 # Parses the kernel's callno.h into the body of syscalls.S
 #
 
+# Calls listed in WRAPPED get their entry point named __sys_<call>
+# instead; libc supplies the real function and calls through to it.
+WRAPPED="execv fork"
+
 # tabs to spaces, just in case
 tr '\t' ' ' |\
 awk '
@@ -19,8 +23,15 @@ awk '
 	# print the name of the call and the number.
 	print $2, $3;
     }
-' | awk '{
+' | awk -v wrapped="$WRAPPED" '
+    BEGIN { n = split(wrapped, w, " "); for (i=1; i<=n; i++) wrap[w[i]] = 1; }
+    {
 	# output something simple that will work in syscalls.S.
-	printf "SYSCALL(%s, %s)\n", $1, $2;
-}'
+	if ($1 in wrap) {
+		printf "SYSCALL(__sys_%s, %s)\n", $1, $2;
+	}
+	else {
+		printf "SYSCALL(%s, %s)\n", $1, $2;
+	}
+    }'
     
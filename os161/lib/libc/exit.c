@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stdio.h>
 #include <unistd.h>
 
 /*
@@ -11,7 +12,10 @@ exit(int code)
 	/*
 	 * In a more complicated libc, this would call functions registered
 	 * with atexit() before calling the syscall to actually exit.
+	 *
+	 * Buffered output would be lost otherwise.
 	 */
+	fflush(NULL);
 
 	_exit(code);
 }
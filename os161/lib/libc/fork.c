@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * fork and execv flush stdio first. Output still sitting in a buffer
+ * would otherwise be printed by both processes after fork, or thrown
+ * away by execv. The system calls themselves are __sys_fork and
+ * __sys_execv; see callno-parse.sh.
+ */
+
+pid_t __sys_fork(void);
+int __sys_execv(const char *prog, char *const *args);
+
+pid_t
+fork(void)
+{
+	fflush(NULL);
+	return __sys_fork();
+}
+
+int
+execv(const char *prog, char *const *args)
+{
+	fflush(NULL);
+	return __sys_execv(prog, args);
+}
@@ -17,39 +17,69 @@
 void *
 memcpy(void *dst, const void *src, size_t len)
 {
-	size_t i;
+	char *d = dst;
+	const char *s = src;
+	long *dw;
+	const long *sw;
 
 	/*
 	 * memcpy does not support overlapping buffers, so always do it
 	 * forwards. (Don't change this without adjusting memmove.)
 	 *
-	 * For speedy copying, optimize the common case where both pointers
-	 * and the length are word-aligned, and copy word-at-a-time instead
-	 * of byte-at-a-time. Otherwise, copy by bytes.
+	 * For speedy copying, when the two pointers have the same
+	 * alignment within a word, copy bytes up to a word boundary,
+	 * then whole words eight at a time, then whatever words and
+	 * bytes are left. Copying eight words per iteration keeps the
+	 * loop overhead down; the loads all happen before the stores, so
+	 * it is still safe for memmove's overlapping forward case.
+	 *
+	 * Pointers that are misaligned relative to each other can only
+	 * be copied by bytes, so that loop is unrolled as well.
 	 *
 	 * The alignment logic below should be portable. We rely on
 	 * the compiler to be reasonably intelligent about optimizing
 	 * the divides and modulos out. Fortunately, it is.
 	 */
 
-	if ((uintptr_t)dst % sizeof(long) == 0 &&
-	    (uintptr_t)src % sizeof(long) == 0 &&
-	    len % sizeof(long) == 0) {
+	if (len >= 2*sizeof(long) &&
+	    (uintptr_t)d % sizeof(long) == (uintptr_t)s % sizeof(long)) {
+
+		while ((uintptr_t)d % sizeof(long) != 0) {
+			*d++ = *s++;
+			len--;
+		}
 
-		long *d = dst;
-		const long *s = src;
+		dw = (long *)d;
+		sw = (const long *)s;
 
-		for (i=0; i<len/sizeof(long); i++) {
-			d[i] = s[i];
+		while (len >= 8*sizeof(long)) {
+			long w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+			long w4 = sw[4], w5 = sw[5], w6 = sw[6], w7 = sw[7];
+			dw[0] = w0; dw[1] = w1; dw[2] = w2; dw[3] = w3;
+			dw[4] = w4; dw[5] = w5; dw[6] = w6; dw[7] = w7;
+			dw += 8;
+			sw += 8;
+			len -= 8*sizeof(long);
+		}
+		while (len >= sizeof(long)) {
+			*dw++ = *sw++;
+			len -= sizeof(long);
 		}
+
+		d = (char *)dw;
+		s = (const char *)sw;
 	}
-	else {
-		char *d = dst;
-		const char *s = src;
 
-		for (i=0; i<len; i++) {
-			d[i] = s[i];
-		}
+	while (len >= 4) {
+		char c0 = s[0], c1 = s[1], c2 = s[2], c3 = s[3];
+		d[0] = c0; d[1] = c1; d[2] = c2; d[3] = c3;
+		d += 4;
+		s += 4;
+		len -= 4;
+	}
+	while (len > 0) {
+		*d++ = *s++;
+		len--;
 	}
 
 	return dst;
@@ -3,6 +3,9 @@
 
 /*
  * printf - C standard I/O function.
+ *
+ * The output goes through the stream's buffer, so a whole line
+ * normally reaches the kernel in one write.
  */
 
 
@@ -13,12 +16,9 @@ static
 void
 __printf_send(void *mydata, const char *data, size_t len)
 {
-	unsigned i;
-	(void)mydata;  /* not needed */
+	FILE *f = mydata;
 
-	for (i=0; i<len; i++) {
-		putchar(data[i]);
-	}
+	fwrite(data, 1, len, f);
 }
 
 /* printf: hand off to vprintf */
@@ -33,9 +33,28 @@ printf(const char *fmt, ...)
 	return chars;
 }
 
-/* vprintf: call __vprintf to do the work. */
+/* fprintf: hand off to vfprintf */
+int
+fprintf(FILE *f, const char *fmt, ...)
+{
+	int chars;
+	va_list ap;
+	va_start(ap, fmt);
+	chars = vfprintf(f, fmt, ap);
+	va_end(ap);
+	return chars;
+}
+
+/* vprintf: print on stdout */
 int
 vprintf(const char *fmt, va_list ap)
 {
-	return __vprintf(__printf_send, NULL, fmt, ap);
+	return vfprintf(stdout, fmt, ap);
+}
+
+/* vfprintf: call __vprintf to do the work. */
+int
+vfprintf(FILE *f, const char *fmt, va_list ap)
+{
+	return __vprintf(__printf_send, f, fmt, ap);
 }
@@ -7,7 +7,8 @@
 int
 puts(const char *s)
 {
-	__puts(s);
-	putchar('\n');
+	if (fputs(s, stdout) == EOF || fputc('\n', stdout) == EOF) {
+		return EOF;
+	}
 	return 0;
 }
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/*
+ * Buffered output streams.
+ *
+ * Output to a stream collects in its buffer and goes out in one
+ * write() when the buffer fills, at each newline for line buffered
+ * streams, on fflush, and at exit, fork and execv. Unbuffered streams
+ * write straight through. stdout picks its mode the first time it is
+ * used: line buffered on the console, fully buffered otherwise. stderr
+ * is always unbuffered.
+ *
+ * Input is not buffered; reading stdin only flushes stdout first so
+ * prompts appear.
+ */
+
+#define F_MODESET	0x1	/* mode chosen by setvbuf or first use */
+
+static char stdout_buf[BUFSIZ];
+
+static FILE __stdin  = { STDIN_FILENO,  _IONBF, 0, 0, 0, 0, NULL };
+static FILE __stdout = { STDOUT_FILENO, _IOFBF, 0, 0, 0, BUFSIZ, stdout_buf };
+static FILE __stderr = { STDERR_FILENO, _IONBF, F_MODESET, 0, 0, 0, NULL };
+
+FILE *stdin = &__stdin;
+FILE *stdout = &__stdout;
+FILE *stderr = &__stderr;
+
+/*
+ * Write LEN bytes straight to the stream's file, coping with short
+ * writes. Returns 0, or EOF with the error flag set.
+ */
+static
+int
+__fwriteall(FILE *f, const char *data, size_t len)
+{
+	int r;
+
+	while (len > 0) {
+		r = write(f->f_fd, data, len);
+		if (r <= 0) {
+			f->f_error = 1;
+			return EOF;
+		}
+		data += r;
+		len -= r;
+	}
+	return 0;
+}
+
+/*
+ * Line buffer streams that go to a character device (the console),
+ * fully buffer the rest.
+ */
+static
+void
+__fsetmode(FILE *f)
+{
+	struct stat st;
+
+	if (f->f_mode != _IONBF && fstat(f->f_fd, &st) == 0 &&
+	    S_ISCHR(st.st_mode)) {
+		f->f_mode = _IOLBF;
+	}
+	f->f_flags |= F_MODESET;
+}
+
+int
+fflush(FILE *f)
+{
+	int r;
+
+	if (f == NULL) {
+		return fflush(stdout) | fflush(stderr);
+	}
+	if (f->f_len == 0) {
+		return 0;
+	}
+
+	r = __fwriteall(f, f->f_buf, f->f_len);
+	f->f_len = 0;
+	return r;
+}
+
+int
+setvbuf(FILE *f, char *buf, int mode, size_t size)
+{
+	if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+		errno = EINVAL;
+		return EOF;
+	}
+	if (fflush(f)) {
+		return EOF;
+	}
+
+	if (mode == _IONBF) {
+		f->f_buf = NULL;
+		f->f_size = 0;
+	}
+	else if (buf != NULL && size > 0) {
+		f->f_buf = buf;
+		f->f_size = size;
+	}
+	else if (f->f_buf == NULL) {
+		/* Only stdout has a buffer of its own */
+		errno = EINVAL;
+		return EOF;
+	}
+	f->f_mode = mode;
+	f->f_flags |= F_MODESET;
+	return 0;
+}
+
+size_t
+fwrite(const void *ptr, size_t size, size_t n, FILE *f)
+{
+	const char *data = ptr;
+	size_t len = size * n, room, chunk, i;
+
+	if (!(f->f_flags & F_MODESET)) {
+		__fsetmode(f);
+	}
+
+	if (f->f_mode == _IONBF) {
+		if (__fwriteall(f, data, len)) {
+			return 0;
+		}
+		return n;
+	}
+
+	while (len > 0) {
+		room = f->f_size - f->f_len;
+
+		/* Big writes skip the buffer once it is empty */
+		if (f->f_len == 0 && len >= f->f_size) {
+			chunk = len - len % f->f_size;
+			if (f->f_mode == _IOLBF) {
+				chunk = len;
+			}
+			if (__fwriteall(f, data, chunk)) {
+				return 0;
+			}
+			data += chunk;
+			len -= chunk;
+			continue;
+		}
+
+		chunk = len < room ? len : room;
+		memcpy(f->f_buf + f->f_len, data, chunk);
+		f->f_len += chunk;
+
+		if (f->f_len == f->f_size) {
+			if (fflush(f)) {
+				return 0;
+			}
+		}
+		else if (f->f_mode == _IOLBF) {
+			for (i=0; i<chunk && data[i] != '\n'; i++);
+			if (i < chunk && fflush(f)) {
+				return 0;
+			}
+		}
+		data += chunk;
+		len -= chunk;
+	}
+	return n;
+}
+
+int
+fputc(int ch, FILE *f)
+{
+	unsigned char c = ch;
+
+	if (fwrite(&c, 1, 1, f) != 1) {
+		return EOF;
+	}
+	return c;
+}
+
+int
+putc(int ch, FILE *f)
+{
+	return fputc(ch, f);
+}
+
+int
+fputs(const char *s, FILE *f)
+{
+	size_t len = strlen(s);
+
+	if (fwrite(s, 1, len, f) != len) {
+		return EOF;
+	}
+	return len;
+}
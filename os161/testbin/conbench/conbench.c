@@ -0,0 +1,105 @@
+/*
+ * conbench - console write throughput benchmark.
+ *
+ * Usage: conbench [bytes] [writesize]
+ *
+ * Writes BYTES (default 1 MB) of text to standard output, WRITESIZE
+ * bytes (default 4096) per write() call, and then reports on standard
+ * error how long it took. The text is lines of 64 characters, each
+ * starting with its offset, so dropped or reordered chunks show up.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+
+#define DEFAULT_BYTES	(1024 * 1024)
+#define DEFAULT_WSIZE	4096
+#define MAX_WSIZE	16384
+#define LINELEN		64
+
+static char buf[MAX_WSIZE];
+
+/* Fills BUF with LEN bytes of the text stream, starting at offset POS */
+static
+void
+fill(char *p, unsigned long pos, int len)
+{
+	char line[LINELEN + 1];
+	unsigned long lineno;
+	int off, n;
+
+	while (len > 0) {
+		lineno = pos / LINELEN;
+		off = pos % LINELEN;
+
+		snprintf(line, sizeof(line), "%08lx ", lineno * LINELEN);
+		memset(line + 9, 'a' + lineno % 26, LINELEN - 10);
+		line[LINELEN - 1] = '\n';
+
+		n = LINELEN - off < len ? LINELEN - off : len;
+		memcpy(p, line + off, n);
+		p += n;
+		pos += n;
+		len -= n;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned long bytes = DEFAULT_BYTES, done, usecs, msecs;
+	int wsize = DEFAULT_WSIZE;
+	int n, r;
+	time_t s1, s2;
+	unsigned long ns1, ns2;
+
+	if (argc > 3) {
+		errx(1, "Usage: conbench [bytes] [writesize]");
+	}
+	if (argc > 1) {
+		n = atoi(argv[1]);
+		if (n <= 0) {
+			errx(1, "bytes must be at least 1");
+		}
+		bytes = n;
+	}
+	if (argc > 2) {
+		wsize = atoi(argv[2]);
+		if (wsize <= 0 || wsize > MAX_WSIZE) {
+			errx(1, "writesize must be 1 to %d", MAX_WSIZE);
+		}
+	}
+
+	s1 = __time(NULL, &ns1);
+	for (done = 0; done < bytes; done += r) {
+		n = bytes - done < (unsigned long) wsize ?
+			(int) (bytes - done) : wsize;
+		fill(buf, done, n);
+		r = write(STDOUT_FILENO, buf, n);
+		if (r < 0) {
+			err(1, "write");
+		}
+		if (r == 0) {
+			errx(1, "write returned 0 after %lu bytes", done);
+		}
+	}
+	s2 = __time(NULL, &ns2);
+
+	usecs = (s2 - s1) * 1000000 + ns2 / 1000 - ns1 / 1000;
+	msecs = usecs / 1000;
+	if (msecs == 0) {
+		msecs = 1;
+	}
+
+	/* Straight to the descriptor, stdio may not be line buffered */
+	snprintf(buf, sizeof(buf), "\nconbench: %lu bytes in %lu.%06lu "
+		 "seconds, %d bytes per write, %lu KB/s\n", bytes,
+		 usecs / 1000000, usecs % 1000000, wsize,
+		 bytes / 1024 * 1000 / msecs);
+	write(STDERR_FILENO, buf, strlen(buf));
+
+	return 0;
+}
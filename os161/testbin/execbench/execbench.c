@@ -0,0 +1,131 @@
+/*
+ * execbench - execv argument passing benchmark.
+ *
+ * Usage: execbench [iterations]
+ *
+ * Forks and execs itself ITERATIONS times (default 20) with 1, 16 and
+ * 256 arguments, counting argv[0], and reports the average time per
+ * fork/exec/wait. The exec'd copy is told apart by its argv[0]; it
+ * checks that every argument arrived intact and exits with status 1
+ * if not.
+ *
+ * Arguments are 24 characters each, so the 256 argument case passes
+ * about 8 KB of strings and pointers.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <err.h>
+
+#define PROG		"/testbin/execbench"
+#define CHILDNAME	"execbench-child"
+#define MAXARGS		256
+#define ARGLEN		24
+
+static const int nargs[] = { 1, 16, 256 };
+
+static char argstore[MAXARGS][ARGLEN + 1];
+static char *args[MAXARGS + 1];
+
+/* Argument I, which the child can recompute to check it */
+static
+void
+makearg(char *buf, int i)
+{
+	int j;
+
+	snprintf(buf, ARGLEN + 1, "arg%04d-", i);
+	for (j = strlen(buf); j < ARGLEN; j++) {
+		buf[j] = 'a' + (i + j) % 26;
+	}
+	buf[ARGLEN] = 0;
+}
+
+/* In the exec'd copy: argv[1] on are the args */
+static
+int
+child(int argc, char *argv[])
+{
+	char want[ARGLEN + 1];
+	int i;
+
+	if (argv[argc] != NULL) {
+		return 1;
+	}
+	for (i = 1; i < argc; i++) {
+		makearg(want, i - 1);
+		if (strcmp(argv[i], want) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static
+void
+run(int n, int iters)
+{
+	time_t s1, s2;
+	unsigned long ns1, ns2, usecs;
+	int i, pid, status;
+
+	args[0] = (char *)CHILDNAME;
+	for (i = 1; i < n; i++) {
+		args[i] = argstore[i - 1];
+	}
+	args[n] = NULL;
+
+	s1 = __time(NULL, &ns1);
+	for (i = 0; i < iters; i++) {
+		pid = fork();
+		if (pid < 0) {
+			err(1, "fork");
+		}
+		if (pid == 0) {
+			execv(PROG, args);
+			err(1, "execv");
+		}
+		if (waitpid(pid, &status, 0) < 0) {
+			err(1, "waitpid");
+		}
+		if (status != 0) {
+			errx(1, "%d args: child saw wrong arguments", n);
+		}
+	}
+	s2 = __time(NULL, &ns2);
+
+	usecs = (s2 - s1) * 1000000 + ns2 / 1000 - ns1 / 1000;
+	printf("%3d args: %d execs in %lu.%03lu s, %lu us each\n", n,
+	       iters, usecs / 1000000, usecs / 1000 % 1000, usecs / iters);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int iters = 20;
+	unsigned i;
+
+	if (strcmp(argv[0], CHILDNAME) == 0) {
+		return child(argc, argv);
+	}
+	if (argc > 1) {
+		iters = atoi(argv[1]);
+		if (iters <= 0) {
+			errx(1, "Usage: execbench [iterations]");
+		}
+	}
+
+	for (i = 0; i < MAXARGS; i++) {
+		makearg(argstore[i], i);
+	}
+	for (i = 0; i < sizeof(nargs) / sizeof(nargs[0]); i++) {
+		run(nargs[i], iters);
+	}
+	printf("execbench done.\n");
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * forkwait - fork/wait throughput benchmark.
+ *
+ * Usage: forkwait [count]
+ *
+ * Forks COUNT children (default 100) that exit straight away, first one
+ * at a time and then in batches, and reports how many fork/exit/waitpid
+ * round trips per second the kernel manages. Every child exits with its
+ * own index so lost or mixed up exit codes are caught too.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+#define DEFAULT_COUNT	100
+#define BATCH		4	/* stays under the kernel's process limit */
+
+static
+void
+now(time_t *secs, unsigned long *nsecs)
+{
+	*secs = __time(NULL, nsecs);
+}
+
+static
+void
+report(const char *what, int count, time_t s1, unsigned long ns1)
+{
+	time_t s2;
+	unsigned long ns2, usecs;
+
+	now(&s2, &ns2);
+	usecs = (s2 - s1) * 1000000 + ns2 / 1000 - ns1 / 1000;
+	if (usecs == 0) {
+		usecs = 1;
+	}
+
+	printf("%s: %d forks in %lu.%06lu seconds, %lu forks/sec, "
+	       "%lu us each\n", what, count, usecs / 1000000,
+	       usecs % 1000000, count * 1000000UL / usecs, usecs / count);
+}
+
+static
+pid_t
+spawn(int code)
+{
+	pid_t pid = fork();
+	if (pid < 0) {
+		err(1, "fork");
+	}
+	if (pid == 0) {
+		_exit(code);
+	}
+	return pid;
+}
+
+static
+void
+reap(pid_t pid, int code)
+{
+	int status;
+
+	if (waitpid(pid, &status, 0) < 0) {
+		err(1, "waitpid %d", pid);
+	}
+	if (status != code) {
+		errx(1, "pid %d exited with %d, expected %d", pid, status,
+		     code);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	pid_t pids[BATCH];
+	time_t secs;
+	unsigned long nsecs;
+	int count = DEFAULT_COUNT;
+	int i, j, n;
+
+	if (argc > 2) {
+		errx(1, "Usage: forkwait [count]");
+	}
+	if (argc == 2) {
+		count = atoi(argv[1]);
+		if (count <= 0) {
+			errx(1, "count must be positive");
+		}
+	}
+
+	/* One child at a time: fork, let it exit, wait for it */
+	now(&secs, &nsecs);
+	for (i = 0; i < count; i++) {
+		reap(spawn(i % 100), i % 100);
+	}
+	report("serial", count, secs, nsecs);
+
+	/* BATCH children at a time, reaped in order */
+	now(&secs, &nsecs);
+	for (i = 0; i < count; i += n) {
+		n = count - i < BATCH ? count - i : BATCH;
+		for (j = 0; j < n; j++) {
+			pids[j] = spawn((i + j) % 100);
+		}
+		for (j = 0; j < n; j++) {
+			reap(pids[j], (i + j) % 100);
+		}
+	}
+	report("batched", count, secs, nsecs);
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * iovtest - test readv, writev, pread and pwrite.
+ *
+ * Usage: iovtest [file]
+ *
+ * Gathers a block from several buffers of odd sizes into FILE
+ * (default "iovtest.tmp") with writev, scatters it back with readv and
+ * checks it. Then overwrites and reads pieces of it at fixed positions
+ * with pwrite and pread, checking that the seek position is left alone.
+ * Finally checks the error cases. The file is removed at the end.
+ */
+
+#include <sys/uio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <err.h>
+
+#define NBUFS		7
+#define TOTAL		(1+7+64+500+513+2000+3)
+
+static const int sizes[NBUFS] = { 1, 7, 64, 500, 513, 2000, 3 };
+static char bufs[NBUFS][2000];
+static char check[TOTAL];
+
+/* The byte that belongs at offset POS of the file */
+static
+char
+pattern(int pos)
+{
+	return 'a' + (pos * 7 + pos / 26) % 26;
+}
+
+static
+void
+setup(struct iovec *iov, int fill)
+{
+	int i, j, pos = 0;
+
+	for (i=0; i<NBUFS; i++) {
+		for (j=0; j<sizes[i]; j++) {
+			bufs[i][j] = fill ? pattern(pos++) : 0;
+		}
+		iov[i].iov_base = bufs[i];
+		iov[i].iov_len = sizes[i];
+	}
+}
+
+static
+void
+verify(const char *what)
+{
+	int i, j, pos = 0;
+
+	for (i=0; i<NBUFS; i++) {
+		for (j=0; j<sizes[i]; j++, pos++) {
+			if (bufs[i][j] != pattern(pos)) {
+				errx(1, "%s: wrong byte at offset %d", what, pos);
+			}
+		}
+	}
+}
+
+static
+void
+expect(int r, int want, const char *what)
+{
+	if (r < 0) {
+		err(1, "%s", what);
+	}
+	if (r != want) {
+		errx(1, "%s: got %d bytes, expected %d", what, r, want);
+	}
+}
+
+static
+void
+expecterr(int r, int code, const char *what)
+{
+	if (r >= 0) {
+		errx(1, "%s: succeeded, expected error %d", what, code);
+	}
+	if (errno != code) {
+		err(1, "%s: expected error %d, got", what, code);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *file = argc > 1 ? argv[1] : "iovtest.tmp";
+	struct iovec iov[NBUFS], big[IOV_MAX + 1];
+	char piece[100];
+	int fd, i;
+
+	fd = open(file, O_RDWR|O_CREAT|O_TRUNC);
+	if (fd < 0) {
+		err(1, "%s", file);
+	}
+
+	/* Gather, then scatter back */
+	setup(iov, 1);
+	expect(writev(fd, iov, NBUFS), TOTAL, "writev");
+	expect(lseek(fd, 0, SEEK_CUR), TOTAL, "lseek after writev");
+	expect(lseek(fd, 0, SEEK_SET), 0, "lseek");
+	setup(iov, 0);
+	expect(readv(fd, iov, NBUFS), TOTAL, "readv");
+	verify("readv");
+	printf("writev/readv: passed\n");
+
+	/* Positional I/O leaves the seek position at the end */
+	for (i=0; i<(int)sizeof(piece); i++) {
+		piece[i] = 'A' + i % 26;
+	}
+	expect(pwrite(fd, piece, sizeof(piece), 1000), sizeof(piece), "pwrite");
+	expect(lseek(fd, 0, SEEK_CUR), TOTAL, "lseek after pwrite");
+	memset(piece, 0, sizeof(piece));
+	expect(pread(fd, piece, sizeof(piece), 1000), sizeof(piece), "pread");
+	for (i=0; i<(int)sizeof(piece); i++) {
+		if (piece[i] != 'A' + i % 26) {
+			errx(1, "pread: wrong byte at offset %d", 1000 + i);
+		}
+	}
+	expect(pread(fd, check, TOTAL, 0), TOTAL, "pread whole file");
+	for (i=0; i<TOTAL; i++) {
+		char want = i >= 1000 && i < 1100 ? 'A' + (i-1000) % 26 :
+			pattern(i);
+		if (check[i] != want) {
+			errx(1, "pread: wrong byte at offset %d", i);
+		}
+	}
+	expect(pread(fd, piece, sizeof(piece), TOTAL), 0, "pread at EOF");
+	expect(lseek(fd, 0, SEEK_CUR), TOTAL, "lseek after pread");
+	printf("pwrite/pread: passed\n");
+
+	/* Errors */
+	for (i=0; i<IOV_MAX + 1; i++) {
+		big[i].iov_base = piece;
+		big[i].iov_len = 1;
+	}
+	expecterr(readv(fd, big, IOV_MAX + 1), EINVAL, "readv IOV_MAX+1");
+	expecterr(readv(fd, iov, -1), EINVAL, "readv negative count");
+	expecterr(readv(fd, NULL, 2), EFAULT, "readv NULL iov");
+	expect(lseek(fd, 0, SEEK_SET), 0, "lseek");
+	iov[0].iov_base = NULL;
+	iov[0].iov_len = 10;
+	expecterr(readv(fd, iov, 1), EFAULT, "readv NULL buffer");
+	expecterr(pread(fd, piece, 1, -1), EINVAL, "pread negative offset");
+	expecterr(pread(-1, piece, 1, 0), EBADF, "pread bad fd");
+	expecterr(pwrite(STDOUT_FILENO, piece, 1, 0), ESPIPE, "pwrite console");
+	printf("errors: passed\n");
+
+	close(fd);
+	remove(file);
+	printf("iovtest done.\n");
+	return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * sleeptest - test nanosleep.
+ *
+ * Usage: sleeptest
+ *
+ * Sleeps for a range of times from a millisecond up to a second and
+ * measures each sleep with __time. A sleep may run over by about a
+ * clock tick but must never be short. Prints the shortest, average and
+ * longest time taken for each length, then checks the error cases.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <err.h>
+
+#define NRUNS		5
+#define NLENGTHS	6
+
+static const unsigned lengths[NLENGTHS] = { 1, 5, 10, 50, 250, 1000 };
+
+static
+unsigned
+usecs_since(time_t s1, unsigned long ns1)
+{
+	unsigned long ns2;
+	time_t s2;
+
+	s2 = __time(NULL, &ns2);
+	return (s2 - s1) * 1000000 + ns2 / 1000 - ns1 / 1000;
+}
+
+static
+void
+timesleep(unsigned msecs)
+{
+	struct timespec ts, rem;
+	unsigned usecs, min = ~0U, max = 0, total = 0;
+	unsigned long ns;
+	time_t s;
+	int i;
+
+	ts.tv_sec = msecs / 1000;
+	ts.tv_nsec = (msecs % 1000) * 1000000;
+
+	for (i=0; i<NRUNS; i++) {
+		rem.tv_sec = rem.tv_nsec = 1;
+		s = __time(NULL, &ns);
+		if (nanosleep(&ts, &rem) < 0) {
+			err(1, "nanosleep %u ms", msecs);
+		}
+		usecs = usecs_since(s, ns);
+
+		if (usecs < msecs * 1000) {
+			errx(1, "nanosleep %u ms: woke after %u us",
+			     msecs, usecs);
+		}
+		if (rem.tv_sec != 0 || rem.tv_nsec != 0) {
+			errx(1, "nanosleep %u ms: time left over", msecs);
+		}
+		if (usecs < min) {
+			min = usecs;
+		}
+		if (usecs > max) {
+			max = usecs;
+		}
+		total += usecs;
+	}
+
+	printf("%5u ms: min %7u us, avg %7u us, max %7u us\n",
+	       msecs, min, total / NRUNS, max);
+}
+
+static
+void
+expecterr(const struct timespec *ts, int code, const char *what)
+{
+	if (nanosleep(ts, NULL) == 0) {
+		errx(1, "%s: succeeded, expected error %d", what, code);
+	}
+	if (errno != code) {
+		err(1, "%s: expected error %d", what, code);
+	}
+}
+
+int
+main(void)
+{
+	struct timespec ts;
+	int i;
+
+	for (i=0; i<NLENGTHS; i++) {
+		timesleep(lengths[i]);
+	}
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 1000000000;
+	expecterr(&ts, EINVAL, "tv_nsec of a second");
+	ts.tv_sec = -1;
+	ts.tv_nsec = 0;
+	expecterr(&ts, EINVAL, "negative tv_sec");
+	expecterr(NULL, EFAULT, "NULL request");
+
+	printf("sleeptest: passed\n");
+	return 0;
+}
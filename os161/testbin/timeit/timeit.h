@@ -2,12 +2,7 @@
 #define TIMEIT_H
 
 #include <stdlib.h>
-
-struct timespec
-{
-        time_t        tv_sec;
-        unsigned long tv_nsec;
-};
+#include <unistd.h>		/* struct timespec */
 
 void timeit_before(struct timespec * before, struct timespec * after);
 void timeit_after(struct timespec * before, struct timespec * after);